@@ -0,0 +1,115 @@
+#include "aabb.h"
+
+#include "sx/string.h"
+
+#if defined(__AVX__)
+#    include <immintrin.h>
+#    define AABB_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define AABB_SSE2 1
+#endif
+
+void aabb_soa_init(aabb_soa_t* soa, float* data, int count)
+{
+    sx_assert(((uintptr_t)data & (AABB_ALIGN - 1)) == 0);
+
+    int capacity = aabb_soa_capacity(count);
+    soa->xmin = data;
+    soa->ymin = data + capacity;
+    soa->xmax = data + capacity * 2;
+    soa->ymax = data + capacity * 3;
+    soa->capacity = capacity;
+
+    for (int i = 0; i < capacity; i++) {
+        aabb_soa_clear(soa, i);
+    }
+}
+
+void aabb_soa_copy(aabb_soa_t* dst, const aabb_soa_t* src)
+{
+    sx_assert(dst->capacity == src->capacity);
+    sx_memcpy(dst->xmin, src->xmin, sizeof(float) * src->capacity * 4);
+}
+
+#if AABB_SSE2
+static inline uint32_t overlap4(const aabb_soa_t* soa, int base, __m128 qxmin, __m128 qymin,
+                                __m128 qxmax, __m128 qymax)
+{
+    __m128 x0 = _mm_cmpge_ps(_mm_load_ps(soa->xmax + base), qxmin);
+    __m128 x1 = _mm_cmpge_ps(qxmax, _mm_load_ps(soa->xmin + base));
+    __m128 y0 = _mm_cmpge_ps(_mm_load_ps(soa->ymax + base), qymin);
+    __m128 y1 = _mm_cmpge_ps(qymax, _mm_load_ps(soa->ymin + base));
+    return (uint32_t)_mm_movemask_ps(_mm_and_ps(_mm_and_ps(x0, x1), _mm_and_ps(y0, y1)));
+}
+#endif
+
+uint32_t aabb_overlap_block(const aabb_soa_t* soa, int base, sx_rect rc)
+{
+    sx_assert((base % AABB_BLOCK_SIZE) == 0 && base < soa->capacity);
+
+#if AABB_AVX
+    __m256 qxmin = _mm256_set1_ps(rc.xmin);
+    __m256 qymin = _mm256_set1_ps(rc.ymin);
+    __m256 qxmax = _mm256_set1_ps(rc.xmax);
+    __m256 qymax = _mm256_set1_ps(rc.ymax);
+    __m256 x0 = _mm256_cmp_ps(_mm256_load_ps(soa->xmax + base), qxmin, _CMP_GE_OQ);
+    __m256 x1 = _mm256_cmp_ps(qxmax, _mm256_load_ps(soa->xmin + base), _CMP_GE_OQ);
+    __m256 y0 = _mm256_cmp_ps(_mm256_load_ps(soa->ymax + base), qymin, _CMP_GE_OQ);
+    __m256 y1 = _mm256_cmp_ps(qymax, _mm256_load_ps(soa->ymin + base), _CMP_GE_OQ);
+    return (uint32_t)_mm256_movemask_ps(
+        _mm256_and_ps(_mm256_and_ps(x0, x1), _mm256_and_ps(y0, y1)));
+#elif AABB_SSE2
+    __m128 qxmin = _mm_set1_ps(rc.xmin);
+    __m128 qymin = _mm_set1_ps(rc.ymin);
+    __m128 qxmax = _mm_set1_ps(rc.xmax);
+    __m128 qymax = _mm_set1_ps(rc.ymax);
+    return overlap4(soa, base, qxmin, qymin, qxmax, qymax) |
+           (overlap4(soa, base + 4, qxmin, qymin, qxmax, qymax) << 4);
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < AABB_BLOCK_SIZE; i++) {
+        int index = base + i;
+        bool overlap = soa->xmax[index] >= rc.xmin && rc.xmax >= soa->xmin[index] &&
+                       soa->ymax[index] >= rc.ymin && rc.ymax >= soa->ymin[index];
+        mask |= (uint32_t)overlap << i;
+    }
+    return mask;
+#endif
+}
+
+static inline int first_bit(uint32_t mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+int aabb_first_overlap(const aabb_soa_t* soa, int start, int end, sx_rect rc)
+{
+    sx_assert(start >= 0 && end <= soa->capacity);
+
+    // the first and last blocks are masked to the range
+    for (int base = start & ~(AABB_BLOCK_SIZE - 1); base < end; base += AABB_BLOCK_SIZE) {
+        uint32_t mask = aabb_overlap_block(soa, base, rc);
+        if (base < start) {
+            mask &= ~((1u << (start - base)) - 1u);
+        }
+        if (end - base < AABB_BLOCK_SIZE) {
+            mask &= (1u << (end - base)) - 1u;
+        }
+
+        if (mask) {
+            return base + first_bit(mask);
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// AABB overlap kernel: boxes are kept in SoA layout (separate min/max x/y arrays), so one query box
+// is tested against a block of 8 boxes at a time (AVX, two SSE2 halves, or a scalar fallback) and
+// the hits come back as a bitmask. The test is inclusive, same as c2AABBtoAABB.
+// Empty boxes never overlap anything, so removed items and the padding stay in place as holes
+
+#include "sx/math.h"
+
+#define AABB_BLOCK_SIZE 8
+#define AABB_ALIGN 32
+
+typedef struct aabb_soa_t {
+    float* xmin;
+    float* ymin;
+    float* xmax;
+    float* ymax;
+    int capacity;    // multiple of AABB_BLOCK_SIZE
+} aabb_soa_t;
+
+static inline int aabb_soa_capacity(int count)
+{
+    return sx_align_mask(count, AABB_BLOCK_SIZE - 1);
+}
+
+// returns the number of floats needed for `data` of `count` boxes
+static inline int aabb_soa_data_size(int count)
+{
+    return aabb_soa_capacity(count) * 4;
+}
+
+// data: array of `aabb_soa_data_size` floats, aligned to AABB_ALIGN. all boxes start empty
+void aabb_soa_init(aabb_soa_t* soa, float* data, int count);
+
+// copies all boxes of `src` to `dst`, they must have the same capacity
+void aabb_soa_copy(aabb_soa_t* dst, const aabb_soa_t* src);
+
+// bit N is set if box `base + N` overlaps `rc`, base must be a multiple of AABB_BLOCK_SIZE
+uint32_t aabb_overlap_block(const aabb_soa_t* soa, int base, sx_rect rc);
+
+// returns the first box in [start, end) that overlaps `rc`, or -1
+int aabb_first_overlap(const aabb_soa_t* soa, int start, int end, sx_rect rc);
+
+static inline void aabb_soa_set(aabb_soa_t* soa, int index, sx_rect rc)
+{
+    soa->xmin[index] = rc.xmin;
+    soa->ymin[index] = rc.ymin;
+    soa->xmax[index] = rc.xmax;
+    soa->ymax[index] = rc.ymax;
+}
+
+static inline void aabb_soa_clear(aabb_soa_t* soa, int index)
+{
+    aabb_soa_set(soa, index, sx_rectf(SX_FLOAT_MAX, SX_FLOAT_MAX, -SX_FLOAT_MAX, -SX_FLOAT_MAX));
+}
+
+static inline void aabb_soa_copy_box(aabb_soa_t* soa, int dst, int src)
+{
+    soa->xmin[dst] = soa->xmin[src];
+    soa->ymin[dst] = soa->ymin[src];
+    soa->xmax[dst] = soa->xmax[src];
+    soa->ymax[dst] = soa->ymax[src];
+}
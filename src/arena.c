@@ -0,0 +1,22 @@
+#include "arena.h"
+
+void arena_init(arena_t* arena, void* buff, size_t size)
+{
+    arena->buff = buff;
+    arena->size = size;
+    arena->offset = 0;
+}
+
+void* arena_alloc(arena_t* arena, size_t size)
+{
+    // aligned by address, the buffer itself may only have the allocator's alignment
+    uintptr_t base = (uintptr_t)arena->buff;
+    size_t start = sx_align_mask(base + arena->offset, (uintptr_t)ARENA_ALIGN - 1) - base;
+    arena->offset = start + size;
+    arena->peak = sx_max(arena->peak, arena->offset);
+    if (arena->offset > arena->size) {
+        ++arena->num_failed;
+        return NULL;
+    }
+    return arena->buff + start;
+}
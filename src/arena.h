@@ -0,0 +1,29 @@
+#pragma once
+
+// Linear arena: scratch memory for the arrays of a frame. Allocations bump an offset in a single
+// buffer and are all released together by arena_reset, so there is no heap traffic once the buffer
+// is big enough. Allocations that don't fit fail, but still count in the high-water mark, so the
+// owner can grow the buffer to it between frames
+
+#include "sx/sx.h"
+
+#define ARENA_ALIGN 16    // of every allocation, enough for the SIMD types
+
+typedef struct arena_t {
+    uint8_t* buff;
+    size_t size;
+    size_t offset;         // end of the last allocation, can go past `size` when they don't fit
+    size_t peak;           // high-water mark of `offset`
+    uint32_t num_failed;   // allocations that didn't fit
+} arena_t;
+
+// can be called again with a bigger buffer after a reset, `peak` and `num_failed` are kept
+void arena_init(arena_t* arena, void* buff, size_t size);
+
+// returns NULL if the allocation doesn't fit, and so will the next ones until the reset
+void* arena_alloc(arena_t* arena, size_t size);
+
+static inline void arena_reset(arena_t* arena)
+{
+    arena->offset = 0;
+}
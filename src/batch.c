@@ -0,0 +1,104 @@
+#include "batch.h"
+
+#include "sx/string.h"
+
+sim_batch_t* sim_batch_create(const sx_alloc* alloc, int count, uint32_t base_seed,
+                              const sim_config_t* config, const sim_jobs_t* jobs)
+{
+    sx_assert(count > 0);
+
+    // single allocation for the batch and all of it's arrays
+    size_t total_sz = sizeof(sim_batch_t) + sizeof(sim_state_t) * count +
+                      sizeof(sim_input_t) * count + sizeof(float) * count +
+                      sizeof(int) * count * 2 + sizeof(uint32_t) * count + sizeof(uint8_t) * count;
+    uint8_t* buff = sx_malloc(alloc, total_sz);
+    if (!buff) {
+        sx_out_of_memory();
+        return NULL;
+    }
+    sx_memset(buff, 0x0, total_sz);
+
+    sim_batch_t* batch = (sim_batch_t*)buff;
+    buff += sizeof(sim_batch_t);
+    batch->sims = (sim_state_t*)buff;
+    buff += sizeof(sim_state_t) * count;
+    batch->inputs = (sim_input_t*)buff;
+    buff += sizeof(sim_input_t) * count;
+    batch->rewards = (float*)buff;
+    buff += sizeof(float) * count;
+    batch->scores = (int*)buff;
+    buff += sizeof(int) * count;
+    batch->lives = (int*)buff;
+    buff += sizeof(int) * count;
+    batch->episodes = (uint32_t*)buff;
+    buff += sizeof(uint32_t) * count;
+    batch->dones = buff;
+
+    batch->count = count;
+    batch->jobs = jobs;
+
+    for (int i = 0; i < count; i++) {
+        // instances are already running in parallel, so they don't dispatch jobs of their own
+        if (!sim_init(&batch->sims[i], alloc, config, base_seed + (uint32_t)i)) {
+            batch->count = i;
+            sim_batch_destroy(batch, alloc);
+            return NULL;
+        }
+        batch->lives[i] = batch->sims[i].player_lives;
+    }
+
+    return batch;
+}
+
+void sim_batch_destroy(sim_batch_t* batch, const sx_alloc* alloc)
+{
+    for (int i = 0; i < batch->count; i++) {
+        sim_release(&batch->sims[i], alloc);
+    }
+    sx_free(alloc, batch);
+}
+
+static void step_batch_cb(int start, int end, int thrd_index, void* user)
+{
+    sx_unused(thrd_index);
+
+    sim_batch_t* batch = user;
+    const float dt = batch->dt;
+
+    for (int i = start; i < end; i++) {
+        sim_state_t* sim = &batch->sims[i];
+        int prev_score = sim->player_score;
+
+        sim_step(sim, &batch->inputs[i], dt);
+
+        bool done = false;
+        for (int e = 0; e < sim->num_events; e++) {
+            if (sim->events[e].type == SIM_EVENT_STATE &&
+                sim->events[e].state == GAME_STATE_GAMEOVER) {
+                done = true;
+            }
+        }
+
+        // score is reset on game over, so there is nothing gained in that step
+        batch->rewards[i] = done ? 0 : (float)(sim->player_score - prev_score);
+        batch->scores[i] = sim->player_score;
+        batch->lives[i] = sim->player_lives;
+        batch->dones[i] = done;
+        batch->episodes[i] += done;
+    }
+}
+
+void sim_batch_step(sim_batch_t* batch, float dt)
+{
+    batch->dt = dt;
+
+    if (batch->jobs) {
+        sx_job_t job = batch->jobs->dispatch(batch->count, step_batch_cb, batch,
+                                             SX_JOB_PRIORITY_NORMAL, 0);
+        batch->jobs->wait_and_del(job);
+    } else {
+        step_batch_cb(0, batch->count, 0, batch);
+    }
+
+    batch->num_ticks += (uint64_t)batch->count;
+}
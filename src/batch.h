@@ -0,0 +1,37 @@
+#pragma once
+
+// Batched simulation environment: steps many independent games (different seeds and inputs) with a
+// single call, sharded over the job dispatcher. Per-instance input and step results are kept in
+// separate arrays (SoA), so the caller (bot, trainer, sweep) can read and write them in bulk
+
+#include "sx/allocator.h"
+
+#include "sim.h"
+
+typedef struct sim_batch_t {
+    int count;
+    float dt;
+    const sim_jobs_t* jobs;
+
+    sim_state_t* sims;
+
+    // input of each instance for the next step, filled by the caller
+    sim_input_t* inputs;
+
+    // results of the last step
+    float* rewards;        // score gained in the step
+    int* scores;
+    int* lives;
+    uint8_t* dones;        // game over happened in the step
+    uint32_t* episodes;    // number of finished games
+    uint64_t num_ticks;    // total ticks of all instances
+} sim_batch_t;
+
+// instances are seeded with `base_seed + index`
+// config: optional, simulation config of all instances, if NULL the default config is used
+// jobs: optional, if NULL all instances are stepped on the calling thread
+sim_batch_t* sim_batch_create(const sx_alloc* alloc, int count, uint32_t base_seed,
+                              const sim_config_t* config, const sim_jobs_t* jobs);
+void sim_batch_destroy(sim_batch_t* batch, const sx_alloc* alloc);
+
+void sim_batch_step(sim_batch_t* batch, float dt);
@@ -0,0 +1,543 @@
+// micro-benchmarks for the simulation hot paths and render batch building
+// sim.c is included directly, so the static update/collision functions can be timed in isolation
+//
+// usage: space-invaders-bench [--iters N] [--counts N,N,..] [--cases NAME,NAME,..] [--seed N]
+//                             [--threads N] [--format csv|json] [--out FILE]
+//   --iters: number of samples for each case (default: 2000)
+//   --counts: entity counts to run each case with, simulation capacities are raised to fit them
+//   --cases: only runs the cases with the given names (default: all)
+//   --threads: number of threads for the simulation jobs, including the main thread (default: 1)
+//   --format: output format (default: csv)
+//   --out: writes the results to a file instead of stdout
+//
+// each sample runs the function on BENCH_REPS fresh copies of the prepared state, so mutations
+// (removed bullets, moved enemies) never leak into the next sample. preparing the copies is not
+// timed and the timer overhead is subtracted from the results
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sx/allocator.h"
+#include "sx/jobs.h"
+#include "sx/timer.h"
+
+#include "render_batch.h"
+#include "sim.c"
+
+#define BENCH_REPS 16
+#define BENCH_MAX_COUNTS 16
+
+typedef enum bench_format_t { BENCH_FORMAT_CSV = 0, BENCH_FORMAT_JSON } bench_format_t;
+
+typedef struct bench_case_t bench_case_t;
+
+typedef struct bench_ctx_t {
+    sim_state_t states[BENCH_REPS + 1];    // copies of the prepared state, last one is the prepared
+    int count;
+    sx_vec2* prev_enemy_pos;
+
+    // render batch outputs
+    sx_mat3* mats;
+    int* enemy_indices;
+    bullet_type_t* bullet_types;
+    explosion_type_t* explosion_types;
+    sx_color* colors;
+} bench_ctx_t;
+
+struct bench_case_t {
+    const char* name;
+    sim_broadphase_t broadphase;
+    void (*setup)(sim_state_t* sim, sx_rng* rng, int count);
+    uint32_t (*run)(bench_ctx_t* ctx, sim_state_t* sim);
+};
+
+typedef struct bench_result_t {
+    const char* name;
+    int count;
+    int iters;
+    double mean_ns;
+    double p50_ns;
+    double p99_ns;
+    double ns_per_entity;
+} bench_result_t;
+
+static const float k_dt = 1.0f / 60.0f;
+
+// sim_jobs_t callbacks don't take a context, so the job context is global
+static sx_job_context* g_job_ctx;
+
+static sx_job_t job_dispatch(int count, sx_job_cb* callback, void* user, sx_job_priority priority,
+                             uint32_t tags)
+{
+    return sx_job_dispatch(g_job_ctx, count, callback, user, priority, tags);
+}
+
+static void job_wait_and_del(sx_job_t job)
+{
+    sx_job_wait_and_del(g_job_ctx, job);
+}
+
+static const sim_jobs_t k_jobs = { .dispatch = job_dispatch, .wait_and_del = job_wait_and_del };
+
+static float rand_range(sx_rng* rng, float _min, float _max)
+{
+    return _min + sx_rng_genf(rng) * (_max - _min);
+}
+
+// kills enemies at random until `count` of them are alive
+static void setup_enemies(sim_state_t* sim, sx_rng* rng, int count)
+{
+    while (sim->num_alive_enemies > count) {
+        int index = sx_rng_gen_rangei(rng, 0, sim->num_enemies - 1);
+        if (sim_enemy_alive(sim, index)) {
+            kill_enemy(sim, index);
+        }
+    }
+    update_enemy_boxes(sim);
+    reset_column_bottoms(sim);
+}
+
+// bullets are spread above the covers, so most of them are tested against everything without
+// being removed by bounds
+static void setup_bullets(sim_state_t* sim, sx_rng* rng, int count)
+{
+    for (int i = 0; i < count; i++) {
+        bullet_type_t type = (i & 1) ? BULLET_TYPE_ALIEN1 : BULLET_TYPE_PLAYER;
+        create_bullet(sim,
+                      sx_vec2f(rand_range(rng, -0.5f, 0.5f) * GAME_BOARD_WIDTH,
+                               rand_range(rng, -0.1f, 0.45f) * GAME_BOARD_HEIGHT),
+                      type);
+    }
+}
+
+static void setup_explosions(sim_state_t* sim, sx_rng* rng, int count)
+{
+    for (int i = 0; i < count; i++) {
+        create_explosion(sim,
+                         sx_vec2f(rand_range(rng, -0.5f, 0.5f) * GAME_BOARD_WIDTH,
+                                  rand_range(rng, -0.5f, 0.5f) * GAME_BOARD_HEIGHT),
+                         EXPLOSION_TYPE_ENEMY);
+        sim->explosions[i].wait_tm = rand_range(rng, 0, ENEMY_EXPLODE_TIME * 1.1f);
+    }
+}
+
+// bullets are spawned a few at a time in the game, so they are already sorted for the sweep
+static void setup_update_bullets(sim_state_t* sim, sx_rng* rng, int count)
+{
+    setup_bullets(sim, rng, count);
+    sort_bullet_order(sim);
+    update_world_hash(sim);
+}
+
+static uint32_t run_update_bullets(bench_ctx_t* ctx, sim_state_t* sim)
+{
+    sx_unused(ctx);
+    update_bullets(sim, k_dt);
+    return (uint32_t)sim->num_bullets;
+}
+
+static void setup_build_enemy_grid(sim_state_t* sim, sx_rng* rng, int count)
+{
+    setup_enemies(sim, rng, count);
+}
+
+static uint32_t run_build_enemy_grid(bench_ctx_t* ctx, sim_state_t* sim)
+{
+    sx_unused(ctx);
+    build_enemy_grid(sim);
+    return (uint32_t)sim->enemy_grid.num_items;
+}
+
+// single player bullet over one of the alive enemies, count is the number of alive enemies
+static void setup_find_enemy_hit(sim_state_t* sim, sx_rng* rng, int count)
+{
+    setup_enemies(sim, rng, count);
+    if (sim->config.broadphase == SIM_BROADPHASE_GRID) {
+        build_enemy_grid(sim);
+    }
+    int target = sim->alive_enemies[sx_rng_gen_rangei(rng, 0, sim->num_alive_enemies - 1)];
+    create_bullet(sim, sim->enemies.pos[target], BULLET_TYPE_PLAYER);
+}
+
+static uint32_t run_find_enemy_hit(bench_ctx_t* ctx, sim_state_t* sim)
+{
+    sx_unused(ctx);
+    const bullet_t* b = &sim->bullets[0];
+    sim_hit_t hit = { 0 };
+    return (uint32_t)find_enemy_hit(sim, sx_rect_move(sim->bounds.bullets[b->type], b->pos), &hit);
+}
+
+// starts in the middle of a move, so the enemies are spread over all of it's parts
+static void setup_update_formation(sim_state_t* sim, sx_rng* rng, int count)
+{
+    setup_enemies(sim, rng, count);
+    sim->formation.move_tm = rand_range(rng, 0, FORMATION_MOVE_DURATION);
+}
+
+static uint32_t run_update_formation(bench_ctx_t* ctx, sim_state_t* sim)
+{
+    sx_unused(ctx);
+    update_formation(sim, k_dt);
+    return (uint32_t)sim->formation.xstep;
+}
+
+// moves the formation down to the covers line, so that the cover tests are not skipped
+static void setup_check_collision_with_covers(sim_state_t* sim, sx_rng* rng, int count)
+{
+    setup_enemies(sim, rng, count);
+    for (int i = 0; i < sim->num_enemies; i++) {
+        sim->enemies.pos[i].y -= GAME_BOARD_HEIGHT * 0.5f;
+    }
+}
+
+// only the bottom-most enemy of each column is tested, as in the game
+static uint32_t run_check_collision_with_covers(bench_ctx_t* ctx, sim_state_t* sim)
+{
+    sx_unused(ctx);
+    return (uint32_t)find_cover_contacts(sim);
+}
+
+static void setup_update_explosions(sim_state_t* sim, sx_rng* rng, int count)
+{
+    setup_explosions(sim, rng, count);
+}
+
+static uint32_t run_update_explosions(bench_ctx_t* ctx, sim_state_t* sim)
+{
+    sx_unused(ctx);
+    update_explosions(sim, k_dt);
+    return (uint32_t)sim->num_explosions;
+}
+
+// count is the number of alive enemies, bullets and explosions are filled to capacity
+static void setup_render_batch(sim_state_t* sim, sx_rng* rng, int count)
+{
+    setup_enemies(sim, rng, count);
+    setup_bullets(sim, rng, sim->config.max_bullets);
+    setup_explosions(sim, rng, sim->config.max_explosions);
+    sim->enemy_explosion = true;
+    sim->player_died = true;
+}
+
+static uint32_t run_render_batch(bench_ctx_t* ctx, sim_state_t* sim)
+{
+    render_interp_t interp = { .prev_enemy_pos = ctx->prev_enemy_pos,
+                               .alpha = 0.5f,
+                               .tick_dt = k_dt,
+                               .snap_dist = sim->tile_size };
+
+    sx_mat3* mats = ctx->mats;
+    int n = render_batch_enemies(sim, &interp, mats, ctx->enemy_indices);
+    n += render_batch_bullets(sim, &interp, mats + n, ctx->bullet_types);
+    n += render_batch_explosions(sim, mats + n, ctx->explosion_types);
+    n += render_batch_covers(sim, mats + n, ctx->colors);
+    return (uint32_t)n + (uint32_t)mats[n > 0 ? n - 1 : 0].f[6];
+}
+
+static const bench_case_t k_cases[] = {
+    { "update_bullets", SIM_BROADPHASE_FORMATION, setup_update_bullets, run_update_bullets },
+    { "build_enemy_grid", SIM_BROADPHASE_GRID, setup_build_enemy_grid, run_build_enemy_grid },
+    { "find_enemy_hit_grid", SIM_BROADPHASE_GRID, setup_find_enemy_hit, run_find_enemy_hit },
+    { "find_enemy_hit_formation", SIM_BROADPHASE_FORMATION, setup_find_enemy_hit,
+      run_find_enemy_hit },
+    { "update_formation", SIM_BROADPHASE_FORMATION, setup_update_formation, run_update_formation },
+    { "check_collision_with_covers", SIM_BROADPHASE_FORMATION, setup_check_collision_with_covers,
+      run_check_collision_with_covers },
+    { "update_explosions", SIM_BROADPHASE_FORMATION, setup_update_explosions,
+      run_update_explosions },
+    { "render_batch", SIM_BROADPHASE_FORMATION, setup_render_batch, run_render_batch },
+};
+
+// capacities are raised to fit `count` entities of any kind, so the same config works for all cases
+static sim_config_t bench_config(int count, sim_broadphase_t broadphase)
+{
+    // square-ish formation, so the board is not stretched to a very tall or wide formation
+    sim_config_t config = sim_default_config();
+    config.enemies_per_row = sx_max(config.enemies_per_row, (int)sx_ceil(sx_sqrt((float)count)));
+    config.num_rows =
+        sx_max(config.num_rows, (count + config.enemies_per_row - 1) / config.enemies_per_row);
+    config.max_bullets = sx_max(config.max_bullets, count);
+    config.max_explosions = sx_max(config.max_explosions, count);
+    config.broadphase = broadphase;
+    return config;
+}
+
+static bool create_ctx(bench_ctx_t* ctx, const sx_alloc* alloc, const sim_config_t* config,
+                       uint32_t seed)
+{
+    for (int i = 0; i < BENCH_REPS + 1; i++) {
+        if (!sim_init(&ctx->states[i], alloc, config, seed)) {
+            return false;
+        }
+    }
+
+    int num_enemies = ctx->states[0].num_enemies;
+    int num_mats =
+        num_enemies + config->max_bullets + config->max_explosions + 2 + config->num_covers;
+    ctx->prev_enemy_pos = sx_malloc(alloc, sizeof(sx_vec2) * num_enemies);
+    ctx->mats = sx_malloc(alloc, sizeof(sx_mat3) * num_mats);
+    ctx->enemy_indices = sx_malloc(alloc, sizeof(int) * num_enemies);
+    ctx->bullet_types = sx_malloc(alloc, sizeof(bullet_type_t) * config->max_bullets);
+    ctx->explosion_types = sx_malloc(alloc, sizeof(explosion_type_t) * (config->max_explosions + 2));
+    ctx->colors = sx_malloc(alloc, sizeof(sx_color) * sx_max(config->num_covers, 1));
+    return ctx->prev_enemy_pos && ctx->mats && ctx->enemy_indices && ctx->bullet_types &&
+           ctx->explosion_types && ctx->colors;
+}
+
+static void destroy_ctx(bench_ctx_t* ctx, const sx_alloc* alloc)
+{
+    for (int i = 0; i < BENCH_REPS + 1; i++) {
+        if (ctx->states[i].enemies.alive.ptr) {
+            sim_release(&ctx->states[i], alloc);
+        }
+    }
+    sx_free(alloc, ctx->prev_enemy_pos);
+    sx_free(alloc, ctx->mats);
+    sx_free(alloc, ctx->enemy_indices);
+    sx_free(alloc, ctx->bullet_types);
+    sx_free(alloc, ctx->explosion_types);
+    sx_free(alloc, ctx->colors);
+    sx_memset(ctx, 0x0, sizeof(*ctx));
+}
+
+// results of the benchmarked functions are accumulated here, so the calls are not optimized away
+static volatile uint32_t g_sink;
+
+static uint64_t timer_overhead(void)
+{
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t t0 = sx_tm_now();
+        uint64_t t1 = sx_tm_now();
+        best = sx_min(best, sx_tm_diff(t1, t0));
+    }
+    return best;
+}
+
+static int compare_double(const void* a, const void* b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static bench_result_t run_case(const bench_case_t* bcase, bench_ctx_t* ctx, double* samples,
+                               int iters, uint64_t overhead)
+{
+    const sim_state_t* prepared = &ctx->states[BENCH_REPS];
+    for (int i = 0; i < prepared->num_enemies; i++) {
+        ctx->prev_enemy_pos[i] = sx_vec2f(prepared->enemies.pos[i].x - prepared->tile_size * 0.5f,
+                                          prepared->enemies.pos[i].y);
+    }
+
+    double total = 0;
+    for (int it = 0; it < iters; it++) {
+        for (int r = 0; r < BENCH_REPS; r++) {
+            sim_copy(&ctx->states[r], prepared);
+        }
+
+        uint32_t sink = 0;
+        uint64_t start_tm = sx_tm_now();
+        for (int r = 0; r < BENCH_REPS; r++) {
+            sink += bcase->run(ctx, &ctx->states[r]);
+        }
+        uint64_t elapsed = sx_tm_diff(sx_tm_now(), start_tm);
+        elapsed = elapsed > overhead ? elapsed - overhead : 0;
+        g_sink += sink;
+
+        samples[it] = (double)elapsed / (double)BENCH_REPS;
+        total += samples[it];
+    }
+
+    qsort(samples, (size_t)iters, sizeof(double), compare_double);
+    double mean = total / (double)iters;
+    return (bench_result_t){ .name = bcase->name,
+                             .count = ctx->count,
+                             .iters = iters,
+                             .mean_ns = mean,
+                             .p50_ns = samples[iters / 2],
+                             .p99_ns = samples[sx_min(iters - 1, (iters * 99) / 100)],
+                             .ns_per_entity = ctx->count > 0 ? mean / (double)ctx->count : 0 };
+}
+
+static void print_usage(const char* name)
+{
+    printf("usage: %s [--iters N] [--counts N,N,..] [--cases NAME,NAME,..] [--seed N]\n"
+           "       [--threads N] [--format csv|json] [--out FILE]\n",
+           name);
+}
+
+static int parse_counts(const char* str, int* counts)
+{
+    int num = 0;
+    while (*str && num < BENCH_MAX_COUNTS) {
+        char* end;
+        long n = strtol(str, &end, 10);
+        if (end == str) {
+            break;
+        }
+        if (n > 0) {
+            counts[num++] = (int)n;
+        }
+        str = *end == ',' ? end + 1 : end;
+    }
+    return num;
+}
+
+// cases: comma separated list of names, NULL matches all
+static bool case_selected(const char* cases, const char* name)
+{
+    if (!cases) {
+        return true;
+    }
+
+    size_t len = strlen(name);
+    for (const char* c = strstr(cases, name); c; c = strstr(c + 1, name)) {
+        if ((c == cases || c[-1] == ',') && (c[len] == ',' || c[len] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void write_results(FILE* f, bench_format_t format, const bench_result_t* results,
+                          int num_results)
+{
+    if (format == BENCH_FORMAT_JSON) {
+        fprintf(f, "[\n");
+        for (int i = 0; i < num_results; i++) {
+            const bench_result_t* r = &results[i];
+            fprintf(f,
+                    "  {\"name\": \"%s\", \"count\": %d, \"iters\": %d, \"mean_ns\": %.1f, "
+                    "\"p50_ns\": %.1f, \"p99_ns\": %.1f, \"ns_per_entity\": %.2f}%s\n",
+                    r->name, r->count, r->iters, r->mean_ns, r->p50_ns, r->p99_ns,
+                    r->ns_per_entity, i < num_results - 1 ? "," : "");
+        }
+        fprintf(f, "]\n");
+    } else {
+        fprintf(f, "name,count,iters,mean_ns,p50_ns,p99_ns,ns_per_entity\n");
+        for (int i = 0; i < num_results; i++) {
+            const bench_result_t* r = &results[i];
+            fprintf(f, "%s,%d,%d,%.1f,%.1f,%.1f,%.2f\n", r->name, r->count, r->iters, r->mean_ns,
+                    r->p50_ns, r->p99_ns, r->ns_per_entity);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int iters = 2000;
+    int counts[BENCH_MAX_COUNTS] = { 1, 5, 10, 20, 55 };
+    int num_counts = 5;
+    uint32_t seed = 1;
+    bench_format_t format = BENCH_FORMAT_CSV;
+    const char* out_file = NULL;
+    const char* cases = NULL;
+    int num_threads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) {
+            iters = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--counts") == 0 && i + 1 < argc) {
+            num_counts = parse_counts(argv[++i], counts);
+        } else if (strcmp(argv[i], "--cases") == 0 && i + 1 < argc) {
+            cases = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char* fmt = argv[++i];
+            if (strcmp(fmt, "json") == 0) {
+                format = BENCH_FORMAT_JSON;
+            } else if (strcmp(fmt, "csv") == 0) {
+                format = BENCH_FORMAT_CSV;
+            } else {
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_file = argv[++i];
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : -1;
+        }
+    }
+
+    if (iters <= 0 || num_counts == 0) {
+        puts("iters and counts must be positive");
+        return -1;
+    }
+
+    sx_tm_init();
+    const sx_alloc* alloc = sx_alloc_malloc();
+
+    if (num_threads > 1) {
+        g_job_ctx = sx_job_create_context(
+            alloc, &(sx_job_context_desc){ .num_threads = num_threads - 1 });
+        if (!g_job_ctx) {
+            puts("could not create job context");
+            return -1;
+        }
+    }
+
+    static bench_ctx_t ctx;
+    double* samples = sx_malloc(alloc, sizeof(double) * iters);
+    const int max_results = (int)(sizeof(k_cases) / sizeof(bench_case_t)) * BENCH_MAX_COUNTS;
+    bench_result_t* results = sx_malloc(alloc, sizeof(bench_result_t) * max_results);
+    if (!samples || !results) {
+        sx_out_of_memory();
+        return -1;
+    }
+
+    uint64_t overhead = timer_overhead();
+    int num_results = 0;
+
+    for (int c = 0; c < (int)(sizeof(k_cases) / sizeof(bench_case_t)); c++) {
+        const bench_case_t* bcase = &k_cases[c];
+        if (!case_selected(cases, bcase->name)) {
+            continue;
+        }
+
+        for (int i = 0; i < num_counts; i++) {
+            int count = counts[i];
+            sim_config_t config = bench_config(count, bcase->broadphase);
+            if (!create_ctx(&ctx, alloc, &config, seed)) {
+                printf("out of memory: %s, count: %d\n", bcase->name, count);
+                destroy_ctx(&ctx, alloc);
+                continue;
+            }
+
+            sim_state_t* prepared = &ctx.states[BENCH_REPS];
+            prepared->jobs = g_job_ctx ? &k_jobs : NULL;
+            sx_rng rng;
+            sx_rng_seed(&rng, seed ^ 0x9e3779b9);
+            bcase->setup(prepared, &rng, count);
+            prepared->num_events = 0;
+
+            ctx.count = count;
+            results[num_results++] = run_case(bcase, &ctx, samples, iters, overhead);
+            destroy_ctx(&ctx, alloc);
+        }
+    }
+
+    int r = 0;
+    FILE* f = out_file ? fopen(out_file, "wt") : stdout;
+    if (f) {
+        write_results(f, format, results, num_results);
+        if (out_file) {
+            fclose(f);
+        }
+    } else {
+        printf("could not open file: %s\n", out_file);
+        r = -1;
+    }
+
+    sx_free(alloc, results);
+    sx_free(alloc, samples);
+    if (g_job_ctx) {
+        sx_job_destroy_context(g_job_ctx, alloc);
+    }
+    return r;
+}
@@ -0,0 +1,88 @@
+#include "grid.h"
+
+#include "sx/string.h"
+
+static inline int grid_coord(float v, float inv_cell_size, int count)
+{
+    // clamp before conversion, so far away coords don't overflow
+    float c = sx_floor(v * inv_cell_size);
+    return (int)sx_clamp(c, 0.0f, (float)(count - 1));
+}
+
+static void grid_size(sx_rect area, float cell_size, int* cols, int* rows)
+{
+    sx_assert(cell_size > 0);
+    *cols = sx_max((int)sx_ceil(sx_rect_width(area) / cell_size), 1);
+    *rows = sx_max((int)sx_ceil(sx_rect_height(area) / cell_size), 1);
+}
+
+int grid_cell_start_size(sx_rect area, float cell_size)
+{
+    int cols, rows;
+    grid_size(area, cell_size, &cols, &rows);
+    return cols * rows + 1;
+}
+
+void grid_init(grid_t* grid, sx_rect area, float cell_size, sx_rect item_bounds, int* cell_start,
+               int* items)
+{
+    grid->origin = area.vmin;
+    grid->cell_size = cell_size;
+    grid->inv_cell_size = 1.0f / cell_size;
+    grid_size(area, cell_size, &grid->cols, &grid->rows);
+    grid->item_bounds = item_bounds;
+    grid->cell_start = cell_start;
+    grid->items = items;
+    grid->num_items = 0;
+    sx_memset(cell_start, 0x0, sizeof(int) * (grid->cols * grid->rows + 1));
+}
+
+static inline int grid_cell_of(const grid_t* grid, sx_vec2 pos)
+{
+    int x = grid_coord(pos.x - grid->origin.x, grid->inv_cell_size, grid->cols);
+    int y = grid_coord(pos.y - grid->origin.y, grid->inv_cell_size, grid->rows);
+    return grid_cell(grid, x, y);
+}
+
+void grid_build(grid_t* grid, const sx_vec2* positions, int stride, const int* indices, int count)
+{
+    const int num_cells = grid->cols * grid->rows;
+    const uint8_t* pos_base = (const uint8_t*)positions;
+    int* cell_start = grid->cell_start;
+
+    // count items in each cell, then turn the counts into end offsets
+    sx_memset(cell_start, 0x0, sizeof(int) * (num_cells + 1));
+    for (int i = 0; i < count; i++) {
+        const sx_vec2* pos = (const sx_vec2*)(pos_base + (size_t)indices[i] * (size_t)stride);
+        ++cell_start[grid_cell_of(grid, *pos)];
+    }
+
+    int offset = 0;
+    for (int c = 0; c < num_cells; c++) {
+        offset += cell_start[c];
+        cell_start[c] = offset;
+    }
+    cell_start[num_cells] = count;
+
+    // fill backwards, decrementing end offsets to start offsets, keeps the input order within cells
+    for (int i = count - 1; i >= 0; i--) {
+        const sx_vec2* pos = (const sx_vec2*)(pos_base + (size_t)indices[i] * (size_t)stride);
+        grid->items[--cell_start[grid_cell_of(grid, *pos)]] = indices[i];
+    }
+
+    grid->num_items = count;
+}
+
+grid_range_t grid_query_range(const grid_t* grid, sx_rect rect)
+{
+    // an item can overlap the rect if its position is in the rect expanded by the item bounds
+    float xmin = rect.xmin - grid->item_bounds.xmax - grid->origin.x;
+    float xmax = rect.xmax - grid->item_bounds.xmin - grid->origin.x;
+    float ymin = rect.ymin - grid->item_bounds.ymax - grid->origin.y;
+    float ymax = rect.ymax - grid->item_bounds.ymin - grid->origin.y;
+
+    return (grid_range_t){ .xmin = grid_coord(xmin, grid->inv_cell_size, grid->cols),
+                           .ymin = grid_coord(ymin, grid->inv_cell_size, grid->rows),
+                           .xmax = grid_coord(xmax, grid->inv_cell_size, grid->cols),
+                           .ymax = grid_coord(ymax, grid->inv_cell_size, grid->rows) };
+}
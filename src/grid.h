@@ -0,0 +1,46 @@
+#pragma once
+
+// Uniform grid broadphase: items are bucketed by the cell of their position with a counting sort,
+// so the whole grid is rebuilt in linear time. Queries visit the cells overlapped by the query rect,
+// expanded by the largest local bounds of the items
+
+#include "sx/math.h"
+
+typedef struct grid_t {
+    sx_vec2 origin;    // bottom-left corner of the grid area
+    float cell_size;
+    float inv_cell_size;
+    int cols;
+    int rows;
+    sx_rect item_bounds;    // union of local bounds of all items, relative to item position
+    int* cell_start;        // items of cell `c` are items[cell_start[c]..cell_start[c+1]]
+    int* items;             // item indices, sorted by cell
+    int num_items;
+} grid_t;
+
+// range of cells, inclusive
+typedef struct grid_range_t {
+    int xmin;
+    int ymin;
+    int xmax;
+    int ymax;
+} grid_range_t;
+
+// returns the number of ints needed for `cell_start` of a grid covering `area`
+int grid_cell_start_size(sx_rect area, float cell_size);
+
+// cell_start: array of `grid_cell_start_size` ints, items: array of max item count ints
+void grid_init(grid_t* grid, sx_rect area, float cell_size, sx_rect item_bounds, int* cell_start,
+               int* items);
+
+// positions: position of item N is at `(uint8_t*)positions + N*stride`
+// indices: items to insert, cells keep the order of this array
+void grid_build(grid_t* grid, const sx_vec2* positions, int stride, const int* indices, int count);
+
+// cells that can contain items overlapping `rect`, items outside the grid area are in border cells
+grid_range_t grid_query_range(const grid_t* grid, sx_rect rect);
+
+static inline int grid_cell(const grid_t* grid, int x, int y)
+{
+    return y * grid->cols + x;
+}
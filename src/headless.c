@@ -0,0 +1,564 @@
+// headless runner: steps the game simulation without window, graphics or audio and reports the
+// simulation throughput. input is generated by a simple deterministic bot
+//
+// usage: space-invaders-headless [--ticks N] [--hz N] [--seed N] [--record FILE] [--replay FILE]
+//                                 [--batch N] [--threads N] [--scaling] [--formation COLSxROWS]
+//                                 [--bullets N] [--covers N] [--broadphase grid|formation]
+//                                 [--check-threads N] [--check-hits] [--stats FILE]
+//   --record: saves the bot input to a replay file
+//   --replay: plays back a replay file as fast as possible instead of running the bot, and verifies
+//             the final state against the recorded one
+//   --batch: runs N games in parallel, each for `ticks` ticks and reports aggregate ticks/sec
+//   --threads: number of threads for batch mode, including the main thread (default: all cores)
+//   --scaling: runs batch mode with 1, 2, 4 .. cores threads and reports the scaling
+//   --formation: enemy formation size, for stress testing (default: 11x5)
+//   --bullets: capacity of bullets and explosions (default: 20)
+//   --covers: number of covers (default: 4)
+//   --broadphase: broadphase of bullets against enemies (default: formation)
+//   --check-threads: runs the same game with the simulation jobs on 1, 2 .. N threads and checks
+//                    that every tick ends in the same state as the single threaded run
+//   --check-hits: fires two bullets at the player and two at the saucer in the same step and checks
+//                 that each target is only taken once
+//   --stats: writes the collision stats of every tick to a CSV file, stage times are in microseconds
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sx/allocator.h"
+#include "sx/array.h"
+#include "sx/jobs.h"
+#include "sx/os.h"
+#include "sx/timer.h"
+
+#include "batch.h"
+#include "replay.h"
+#include "sim.h"
+
+typedef struct bot_t {
+    sx_rng rng;
+    float target_x;
+    float retarget_tm;
+} bot_t;
+
+// wanders between random points on the board and shoots whenever it can
+static void bot_input(bot_t* bot, const sim_state_t* sim, float dt, sim_input_t* input)
+{
+    bot->retarget_tm -= dt;
+    if (bot->retarget_tm <= 0) {
+        bot->target_x = (sx_rng_genf(&bot->rng) - 0.5f) * GAME_BOARD_WIDTH * 0.8f;
+        bot->retarget_tm = 0.5f + sx_rng_genf(&bot->rng) * 1.5f;
+    }
+
+    float dx = bot->target_x - sim->player.pos.x;
+    input->left = dx < -0.01f;
+    input->right = dx > 0.01f;
+    input->shoot = true;
+    input->movex = 0;
+}
+
+static void print_usage(const char* name)
+{
+    printf("usage: %s [--ticks N] [--hz N] [--seed N] [--record FILE] [--replay FILE]\n"
+           "       [--batch N] [--threads N] [--scaling] [--formation COLSxROWS] [--bullets N]\n"
+           "       [--covers N] [--broadphase grid|formation] [--check-threads N]\n"
+           "       [--check-hits] [--stats FILE]\n",
+           name);
+}
+
+// sim_jobs_t callbacks don't take a context, so the headless job context is global
+static sx_job_context* g_job_ctx;
+
+static sx_job_t job_dispatch(int count, sx_job_cb* callback, void* user, sx_job_priority priority,
+                             uint32_t tags)
+{
+    return sx_job_dispatch(g_job_ctx, count, callback, user, priority, tags);
+}
+
+static void job_wait_and_del(sx_job_t job)
+{
+    sx_job_wait_and_del(g_job_ctx, job);
+}
+
+static const sim_jobs_t k_jobs = { .dispatch = job_dispatch, .wait_and_del = job_wait_and_del };
+
+// steps the games of `batch` for `num_ticks` each, with a bot playing each game
+// returns aggregate ticks/sec
+static double step_batch(sim_batch_t* batch, bot_t* bots, int num_threads, int num_ticks, int hz,
+                         uint32_t seed, bool verbose)
+{
+    const int num_games = batch->count;
+    for (int i = 0; i < num_games; i++) {
+        bots[i] = (bot_t){ 0 };
+        sx_rng_seed(&bots[i].rng, (seed + (uint32_t)i) ^ 0x9e3779b9);
+    }
+
+    const float dt = 1.0f / (float)hz;
+    uint64_t start_tm = sx_tm_now();
+    for (int t = 0; t < num_ticks; t++) {
+        for (int i = 0; i < num_games; i++) {
+            bot_input(&bots[i], &batch->sims[i], dt, &batch->inputs[i]);
+        }
+        sim_batch_step(batch, dt);
+    }
+    double elapsed = sx_tm_sec(sx_tm_diff(sx_tm_now(), start_tm));
+    double ticks_per_sec = elapsed > 0 ? (double)batch->num_ticks / elapsed : 0.0;
+
+    if (verbose) {
+        uint64_t num_episodes = 0;
+        int best_score = 0;
+        for (int i = 0; i < num_games; i++) {
+            num_episodes += batch->episodes[i];
+            best_score = sx_max(best_score, batch->sims[i].high_score);
+        }
+        printf("games: %d, threads: %d, ticks per game: %d (%d hz)\n", num_games, num_threads,
+               num_ticks, hz);
+        printf("elapsed: %.3f sec\n", elapsed);
+        printf("ticks/sec: %.0f\n", ticks_per_sec);
+        printf("games over: %llu, best score: %d\n", (unsigned long long)num_episodes, best_score);
+    }
+    return ticks_per_sec;
+}
+
+// steps `num_games` instances for `num_ticks` each, using `num_threads` threads
+// returns aggregate ticks/sec, or 0 if the games could not be created
+static double run_batch(const sx_alloc* alloc, const sim_config_t* config, int num_games,
+                        int num_threads, int num_ticks, int hz, uint32_t seed, bool verbose)
+{
+    if (num_threads > 1) {
+        g_job_ctx = sx_job_create_context(
+            alloc, &(sx_job_context_desc){ .num_threads = num_threads - 1 });
+        if (!g_job_ctx) {
+            puts("could not create job context");
+            return 0;
+        }
+    }
+
+    double ticks_per_sec = 0;
+    sim_batch_t* batch =
+        sim_batch_create(alloc, num_games, seed, config, num_threads > 1 ? &k_jobs : NULL);
+    bot_t* bots = batch ? sx_malloc(alloc, sizeof(bot_t) * num_games) : NULL;
+    if (!batch) {
+        puts("could not create batch");
+    } else if (!bots) {
+        puts("out of memory");
+    } else {
+        ticks_per_sec = step_batch(batch, bots, num_threads, num_ticks, hz, seed, verbose);
+    }
+
+    sx_free(alloc, bots);
+    if (batch) {
+        sim_batch_destroy(batch, alloc);
+    }
+    if (g_job_ctx) {
+        sx_job_destroy_context(g_job_ctx, alloc);
+        g_job_ctx = NULL;
+    }
+    return ticks_per_sec;
+}
+
+static void run_scaling(const sx_alloc* alloc, const sim_config_t* config, int num_games,
+                        int num_ticks, int hz, uint32_t seed)
+{
+    int num_cores = sx_max(sx_os_numcores(), 1);
+    double base = 0;
+
+    printf("games: %d, ticks per game: %d (%d hz)\n", num_games, num_ticks, hz);
+    printf("%8s %14s %8s %10s\n", "threads", "ticks/sec", "speedup", "efficiency");
+    for (int n = 1;; n = sx_min(n * 2, num_cores)) {
+        double tps = run_batch(alloc, config, num_games, n, num_ticks, hz, seed, false);
+        if (n == 1) {
+            base = tps;
+        }
+        double speedup = base > 0 ? tps / base : 0;
+        printf("%8d %14.0f %7.2fx %9.0f%%\n", n, tps, speedup, speedup * 100.0 / (double)n);
+        if (n == num_cores) {
+            break;
+        }
+    }
+}
+
+static const char* k_hit_names[SIM_HIT_COUNT] = { "none",   "enemy",  "saucer",     "player",
+                                                   "cover",  "bounds", "enemy_cover" };
+static const char* k_stage_names[SIM_COLLISION_STAGE_COUNT] = { "cover_contacts", "build", "detect",
+                                                                "resolve", "bullets" };
+
+static void write_stats_header(FILE* f)
+{
+    fputs("tick,candidates,candidates_dropped,tests,enemy_queries,enemy_queries_rejected", f);
+    for (int i = SIM_HIT_NONE + 1; i < SIM_HIT_COUNT; i++) {
+        fprintf(f, ",hits_%s", k_hit_names[i]);
+    }
+    fputs(",hits_bullet", f);
+    for (int i = 0; i < SIM_COLLISION_STAGE_COUNT; i++) {
+        fprintf(f, ",%s_us", k_stage_names[i]);
+    }
+    fputs("\n", f);
+}
+
+static void write_stats_row(FILE* f, int tick, const sim_collision_stats_t* stats)
+{
+    fprintf(f, "%d,%llu,%llu,%llu,%llu,%llu", tick, (unsigned long long)stats->num_candidates,
+            (unsigned long long)stats->num_candidates_dropped,
+            (unsigned long long)stats->num_tests, (unsigned long long)stats->num_enemy_queries,
+            (unsigned long long)stats->num_enemy_queries_rejected);
+    for (int i = SIM_HIT_NONE + 1; i < SIM_HIT_COUNT; i++) {
+        fprintf(f, ",%llu", (unsigned long long)stats->hits[i]);
+    }
+    fprintf(f, ",%llu", (unsigned long long)stats->num_bullet_hits);
+    for (int i = 0; i < SIM_COLLISION_STAGE_COUNT; i++) {
+        fprintf(f, ",%.3f", sx_tm_us(stats->stage_ticks[i]));
+    }
+    fputs("\n", f);
+}
+
+// the bullet detection is split between the job threads differently for each thread count, so a
+// result that depends on the split or on thread timing shows up as a checksum mismatch
+// returns false if any thread count diverges from the single threaded run
+static bool run_thread_check(const sx_alloc* alloc, const sim_config_t* config, int max_threads,
+                             int num_ticks, int hz, uint32_t seed)
+{
+    uint32_t* checksums = sx_malloc(alloc, sizeof(uint32_t) * num_ticks);
+    if (!checksums) {
+        puts("out of memory");
+        return false;
+    }
+
+    const float dt = 1.0f / (float)hz;
+    bool ok = true;
+    printf("ticks: %d (%d hz)\n", num_ticks, hz);
+    printf("%8s %8s %12s %12s\n", "threads", "score", "checksum", "result");
+    for (int n = 1; n <= max_threads; n++) {
+        if (n > 1) {
+            g_job_ctx =
+                sx_job_create_context(alloc, &(sx_job_context_desc){ .num_threads = n - 1 });
+            if (!g_job_ctx) {
+                puts("could not create job context");
+                ok = false;
+                break;
+            }
+        }
+
+        sim_state_t sim;
+        if (!sim_init(&sim, alloc, config, seed)) {
+            puts("out of memory");
+            if (g_job_ctx) {
+                sx_job_destroy_context(g_job_ctx, alloc);
+                g_job_ctx = NULL;
+            }
+            ok = false;
+            break;
+        }
+        // every step with a bullet is dispatched, normal play rarely has enough bullets for one
+        sim.jobs = n > 1 ? &k_jobs : NULL;
+        sim.min_bullets_per_job = 1;
+
+        bot_t bot = { 0 };
+        sx_rng_seed(&bot.rng, seed ^ 0x9e3779b9);
+
+        int mismatch_tick = -1;
+        for (int i = 0; i < num_ticks; i++) {
+            sim_input_t input;
+            bot_input(&bot, &sim, dt, &input);
+            sim_step(&sim, &input, dt);
+
+            uint32_t checksum = sim_checksum(&sim);
+            if (n == 1) {
+                checksums[i] = checksum;
+            } else if (checksum != checksums[i]) {
+                mismatch_tick = i;
+                break;
+            }
+        }
+
+        if (mismatch_tick == -1) {
+            printf("%8d %8d   0x%08x %12s\n", n, sim.player_score, checksums[num_ticks - 1], "ok");
+        } else {
+            printf("%8d %8d   0x%08x   diverged at tick %d\n", n, sim.player_score,
+                   sim_checksum(&sim), mismatch_tick);
+            ok = false;
+        }
+
+        sim_release(&sim, alloc);
+        if (g_job_ctx) {
+            sx_job_destroy_context(g_job_ctx, alloc);
+            g_job_ctx = NULL;
+        }
+    }
+
+    sx_free(alloc, checksums);
+    return ok;
+}
+
+// two bullets that reach the same target in one step: the first one takes it, and the second one
+// must not take it again when it looks for a new target in the same step
+// returns false if the player loses more than one life or the saucer is scored more than once
+static bool run_hit_check(const sx_alloc* alloc, const sim_config_t* config, int hz, uint32_t seed)
+{
+    sim_state_t sim;
+    if (!sim_init(&sim, alloc, config, seed)) {
+        puts("out of memory");
+        return false;
+    }
+
+    const float dt = 1.0f / (float)hz;
+    sim_input_t input = { 0 };
+    while (sim.state != GAME_STATE_INGAME) {
+        sim_step(&sim, &input, dt);
+    }
+
+    // the saucer is parked above the formation, the bullets start inside their targets
+    sim.saucer = (saucer_t){ .pos = sx_vec2f(0, GAME_BOARD_HEIGHT * 0.5f - sim.tile_size),
+                             .hit_score = 100 };
+    for (int i = 0; i < 2; i++) {
+        sim_add_bullet(&sim, sim.saucer.pos, BULLET_TYPE_PLAYER);
+        sim_add_bullet(&sim, sim.player.pos, BULLET_TYPE_ALIEN1);
+    }
+
+    int lives = sim.player_lives;
+    int score = sim.player_score;
+    sim_step(&sim, &input, dt);
+
+    bool player_ok = sim.player_lives == lives - 1;
+    bool saucer_ok = sim.player_score == score + sim.saucer.hit_score;
+    printf("%-8s lives %d -> %d %12s\n", "player", lives, sim.player_lives,
+           player_ok ? "ok" : "failed");
+    printf("%-8s score %d -> %d %12s\n", "saucer", score, sim.player_score,
+           saucer_ok ? "ok" : "failed");
+
+    sim_release(&sim, alloc);
+    return player_ok && saucer_ok;
+}
+
+int main(int argc, char* argv[])
+{
+    int num_ticks = 1000000;
+    int hz = 60;
+    uint32_t seed = 1;
+    const char* record_file = NULL;
+    const char* replay_file = NULL;
+    const char* stats_file = NULL;
+    int num_games = 0;
+    int num_threads = 0;
+    bool scaling = false;
+    int check_threads = 0;
+    bool check_hits = false;
+    sim_config_t config = sim_default_config();
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            num_ticks = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--hz") == 0 && i + 1 < argc) {
+            hz = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_file = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_file = argv[++i];
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            num_games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--scaling") == 0) {
+            scaling = true;
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            stats_file = argv[++i];
+        } else if (strcmp(argv[i], "--check-threads") == 0 && i + 1 < argc) {
+            check_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--check-hits") == 0) {
+            check_hits = true;
+        } else if (strcmp(argv[i], "--formation") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &config.enemies_per_row, &config.num_rows) != 2) {
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--bullets") == 0 && i + 1 < argc) {
+            config.max_bullets = config.max_explosions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--covers") == 0 && i + 1 < argc) {
+            config.num_covers = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--broadphase") == 0 && i + 1 < argc) {
+            const char* broadphase = argv[++i];
+            if (strcmp(broadphase, "grid") == 0) {
+                config.broadphase = SIM_BROADPHASE_GRID;
+            } else if (strcmp(broadphase, "formation") == 0) {
+                config.broadphase = SIM_BROADPHASE_FORMATION;
+            } else {
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else {
+            print_usage(argv[0]);
+            return strcmp(argv[i], "--help") == 0 ? 0 : -1;
+        }
+    }
+
+    if (config.enemies_per_row <= 0 || config.num_rows <= 0 || config.max_bullets <= 0 ||
+        config.num_covers < 0) {
+        puts("invalid formation, bullets or covers");
+        return -1;
+    }
+
+    const sx_alloc* alloc = sx_alloc_malloc();
+
+    if (num_games > 0 || scaling) {
+        if (num_ticks <= 0 || hz <= 0) {
+            puts("ticks and hz must be positive");
+            return -1;
+        }
+
+        sx_tm_init();
+        num_games = num_games > 0 ? num_games : 1024;
+        if (scaling) {
+            run_scaling(alloc, &config, num_games, num_ticks, hz, seed);
+        } else {
+            num_threads = num_threads > 0 ? num_threads : sx_os_numcores();
+            run_batch(alloc, &config, num_games, num_threads, num_ticks, hz, seed, true);
+        }
+        return 0;
+    }
+
+    if (check_threads > 0) {
+        if (num_ticks <= 0 || hz <= 0) {
+            puts("ticks and hz must be positive");
+            return -1;
+        }
+        return run_thread_check(alloc, &config, check_threads, num_ticks, hz, seed) ? 0 : -1;
+    }
+
+    if (check_hits) {
+        if (hz <= 0) {
+            puts("hz must be positive");
+            return -1;
+        }
+        return run_hit_check(alloc, &config, hz, seed) ? 0 : -1;
+    }
+
+    replay_t replay = { 0 };
+    if (replay_file) {
+        if (!replay_load(&replay, alloc, replay_file)) {
+            printf("could not load replay: %s\n", replay_file);
+            return -1;
+        }
+        config = replay.config;
+        seed = replay.seed;
+        hz = replay.tick_rate;
+        num_ticks = replay.num_ticks;
+    } else if (record_file) {
+        replay_begin(&replay, &config, seed, hz);
+    }
+
+    if (num_ticks <= 0 || hz <= 0) {
+        puts("ticks and hz must be positive");
+        return -1;
+    }
+
+    sx_tm_init();
+
+    sim_state_t sim;
+    if (!sim_init(&sim, alloc, &config, seed)) {
+        puts("out of memory");
+        return -1;
+    }
+
+    FILE* stats_f = NULL;
+    if (stats_file) {
+        stats_f = fopen(stats_file, "w");
+        if (!stats_f) {
+            printf("could not open stats file: %s\n", stats_file);
+            sim_release(&sim, alloc);
+            return -1;
+        }
+        write_stats_header(stats_f);
+        sim.time_collisions = true;
+    }
+
+    bot_t bot = { 0 };
+    sx_rng_seed(&bot.rng, seed ^ 0x9e3779b9);
+
+    const float dt = 1.0f / (float)hz;
+    int num_gameovers = 0;
+    int num_sounds = 0;
+    sim_collision_stats_t stats = { 0 };
+    int best_score = 0;
+
+    uint64_t start_tm = sx_tm_now();
+    for (int i = 0; i < num_ticks; i++) {
+        sim_input_t input;
+        if (replay_file) {
+            if (!replay_next(&replay, &input)) {
+                num_ticks = i;
+                break;
+            }
+        } else {
+            bot_input(&bot, &sim, dt, &input);
+            if (record_file) {
+                replay_record(&replay, alloc, &input);
+            }
+        }
+        sim_step(&sim, &input, dt);
+        sim_collision_stats_add(&stats, &sim.collision_stats);
+        if (stats_f) {
+            write_stats_row(stats_f, i, &sim.collision_stats);
+        }
+
+        for (int e = 0; e < sim.num_events; e++) {
+            const sim_event_t* ev = &sim.events[e];
+            if (ev->type == SIM_EVENT_SOUND) {
+                ++num_sounds;
+            } else if (ev->type == SIM_EVENT_STATE && ev->state == GAME_STATE_GAMEOVER) {
+                ++num_gameovers;
+            }
+        }
+        best_score = sx_max(best_score, sim.player_score);
+    }
+    double elapsed = sx_tm_sec(sx_tm_diff(sx_tm_now(), start_tm));
+
+    printf("ticks: %d (%d hz, %.1f sec of game time)\n", num_ticks, hz,
+           (double)num_ticks / (double)hz);
+    printf("elapsed: %.3f sec\n", elapsed);
+    printf("ticks/sec: %.0f\n", elapsed > 0 ? (double)num_ticks / elapsed : 0.0);
+    printf("games over: %d, best score: %d, high score: %d, sounds: %d\n", num_gameovers,
+           best_score, sim.high_score, num_sounds);
+    uint64_t num_player_queries = stats.num_enemy_queries + stats.num_enemy_queries_rejected;
+    printf("player bullet queries rejected by formation box: %llu/%llu (%.1f%%)\n",
+           (unsigned long long)stats.num_enemy_queries_rejected,
+           (unsigned long long)num_player_queries,
+           num_player_queries > 0
+               ? (double)stats.num_enemy_queries_rejected * 100.0 / (double)num_player_queries
+               : 0.0);
+    printf("collision candidates: %llu (dropped %llu), tests: %llu\n",
+           (unsigned long long)stats.num_candidates,
+           (unsigned long long)stats.num_candidates_dropped, (unsigned long long)stats.num_tests);
+    printf("dropped when full: bullets %u, explosions %u\n", sim.bullet_pool.num_exhausted,
+           sim.explosion_pool.num_exhausted);
+    if (stats_f) {
+        fclose(stats_f);
+        printf("stats: %s\n", stats_file);
+    }
+
+    int r = 0;
+    if (record_file) {
+        replay.final_score = sim.player_score;
+        replay.final_checksum = sim_checksum(&sim);
+        if (replay_save(&replay, record_file)) {
+            printf("recorded: %s (%d runs)\n", record_file, sx_array_count(replay.runs));
+        } else {
+            printf("could not save replay: %s\n", record_file);
+            r = -1;
+        }
+    } else if (replay_file) {
+        uint32_t checksum = sim_checksum(&sim);
+        if (checksum == replay.final_checksum && sim.player_score == replay.final_score) {
+            printf("replay verified: score %d, checksum 0x%08x\n", sim.player_score, checksum);
+        } else {
+            printf("replay mismatch: score %d (recorded %d), checksum 0x%08x (recorded 0x%08x)\n",
+                   sim.player_score, replay.final_score, checksum, replay.final_checksum);
+            r = -1;
+        }
+    }
+
+    replay_release(&replay, alloc);
+    sim_release(&sim, alloc);
+    return r;
+}
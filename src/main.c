@@ -14,12 +14,10 @@
 #include "rizz/rizz.h"
 #include "rizz/sound.h"
 
-#define CUTE_C2_IMPLEMENTATION
-SX_PRAGMA_DIAGNOSTIC_PUSH()
-SX_PRAGMA_DIAGNOSTIC_IGNORED_CLANG("-Wswitch")
-SX_PRAGMA_DIAGNOSTIC_IGNORED_CLANG("-Wunused-function")
-#include "cute_c2.h"
-SX_PRAGMA_DIAGNOSTIC_POP()
+#include "arena.h"
+#include "render_batch.h"
+#include "replay.h"
+#include "sim.h"
 
 RIZZ_STATE static rizz_api_core* the_core;
 RIZZ_STATE static rizz_api_gfx* the_gfx;
@@ -34,23 +32,6 @@ RIZZ_STATE static rizz_api_camera* the_camera;
 RIZZ_STATE static rizz_api_input* the_input;
 RIZZ_STATE static rizz_api_snd* the_sound;
 
-#define ENEMIES_PER_ROW 11
-#define NUM_ROWS 5
-#define MAX_ENEMIES (ENEMIES_PER_ROW * NUM_ROWS)
-#define MAX_BULLETS 20
-#define GAME_BOARD_WIDTH 1.0f
-#define GAME_BOARD_HEIGHT 1.2f
-#define ENEMY_WAIT_DURATION 0.5f
-#define PLAYER_BULLET_INTERVAL 0.5f
-#define ENEMY_EXPLODE_TIME 0.2f
-#define ENEMY_SHOOT_INTERVAL 1.0f
-#define ENEMY_TILE_MOVE_DURATION 0.5f
-#define PLAYER_EXPLOSION_DURATION 1.0f
-#define NUM_COVERS 4
-#define HEARTBEAT_INTERVAL 1.5f
-#define NUM_LIVES 3
-#define GAME_STATE_DURATION 2000
-
 #define KEY_LEFT 1
 #define KEY_RIGHT 2
 #define KEY_SHOOT 3
@@ -58,31 +39,11 @@ RIZZ_STATE static rizz_api_snd* the_sound;
 
 #define SCORE_FOURCC sx_makefourcc('S', 'C', 'O', 'R')
 
-typedef enum enemy_direction_t {
-    ENEMY_MOVEMENT_RIGHT = 0,
-    ENEMY_MOVEMENT_DOWN,
-    ENEMY_MOVEMENT_LEFT
-} enemy_direction_t;
-
-typedef enum bullet_type_t {
-    BULLET_TYPE_PLAYER = 0,
-    BULLET_TYPE_ALIEN1,
-    BULLET_TYPE_COUNT
-} bullet_type_t;
-
-typedef enum sound_type_t {
-    SOUND_EXPLODE1 = 0,
-    SOUND_EXPLODE2,
-    SOUND_EXPLODE3,
-    SOUND_EXPLODE4,
-    SOUND_HEARTBEAT,
-    SOUND_HIT,
-    SOUND_SHOOT,
-    SOUND_WIN,
-    SOUND_BONUS,
-    SOUND_SAUCER,
-    SOUND_COUNT
-} sound_type_t;
+#define DEFAULT_TICK_RATE 60
+#define MAX_TICKS_PER_FRAME 8
+#define REPLAY_FILE "replay.dat"
+#define REPLAY_UNCAPPED_FRAME_BUDGET 0.1    // seconds spent on uncapped playback each frame
+#define FRAME_ARENA_SIZE (256 * 1024)    // initial size, grows to the peak of the frames
 
 typedef enum render_stage_t {
     RENDER_STAGE_GAME = 0,
@@ -90,72 +51,11 @@ typedef enum render_stage_t {
     RENDER_STAGE_COUNT
 } render_stage_t;
 
-typedef enum game_state_t {
-    GAME_STATE_INGAME = 0,
-    GAME_STATE_GAMEOVER,
-    GAME_STATE_WIN
-} game_state_t;
-
-typedef struct enemy_t {
-    sx_vec2 start_pos;
-    sx_vec2 target_pos;
-    sx_vec2 pos;
-    sound_type_t explode_sound;
-    float wait_tm;
-    float move_tm;
-    float wait_duration;
-    int xstep;
-    enemy_direction_t dir;
-    float shoot_wait_interval;
-    int hit_score;
-    bool move;
-    bool allow_next_move;
-    bool dead;
-} enemy_t;
-
-typedef struct player_t {
-    sx_vec2 pos;
-    float bullet_tm;
-    rizz_sprite sprite;
-    float speed;
-    bool dead;
-} player_t;
-
-typedef struct cover_t {
-    sx_vec2 pos;
-    int health;
-    bool dead;
-} cover_t;
-
-typedef struct saucer_t {
-    bool dead;
-    sx_vec2 pos;
-    rizz_sprite sprite;
-    float t;
-    float speed;
-    float wait_tm;
-    float wait_duration;
-    int hit_score;
-} saucer_t;
-
-typedef struct bullet_t {
-    sx_vec2 pos;
-    bullet_type_t type;
-    rizz_sprite sprite;
-    float speed;
-    int damage;
-} bullet_t;
-
-typedef struct explosion_t {
-    sx_vec2 pos;
-    rizz_sprite sprite;
-    float wait_tm;
-} explosion_t;
-
-typedef struct collision_data_t {
-    int bullet_index;
-    int hit_index;
-} collision_data_t;
+typedef enum replay_mode_t {
+    REPLAY_MODE_NONE = 0,
+    REPLAY_MODE_RECORD,
+    REPLAY_MODE_PLAYBACK
+} replay_mode_t;
 
 typedef enum debugger_t {
     DEBUGGER_MEMORY = 0,
@@ -164,53 +64,64 @@ typedef enum debugger_t {
     DEBUGGER_SPRITES,
     DEBUGGER_SOUND,
     DEBUGGER_INPUT,
+    DEBUGGER_COLLISIONS,
     DEBUGGER_COUNT
 } debugger_t;
 
+// arrays for building batched draws, each batch is built and drawn before the next one, so they
+// are shared, taken from the frame arena and sized to the biggest batch of the frame
+typedef struct render_buffers_t {
+    sx_mat3* mats;
+    rizz_sprite* sprites;
+    sx_color* colors;
+    int* enemy_indices;
+    bullet_type_t* bullet_types;
+    explosion_type_t* explosion_types;
+    int count;
+} render_buffers_t;
+
 typedef struct game_t {
     sx_alloc* alloc;
-    sx_rng rng;
-    enemy_t enemies[MAX_ENEMIES];
-    enemy_t dummy_enemy;
-    cover_t covers[NUM_COVERS];
+    sx_rng rng;    // only used for visuals, gameplay has it's own rng in `sim`
+    sim_state_t sim;
+    sim_config_t sim_config;    // used for the next restart, can be changed from dev menu
+    sim_jobs_t jobs;
+    bool sim_failed;    // a restart could not allocate any simulation, nothing is stepped or drawn
+    int tick_rate;          // simulation steps per second
+    float tick_accum;       // frame time that is not simulated yet
+    float tick_alpha;       // interpolation factor between previous and current tick [0, 1]
+    uint64_t frame_bounds_lookups;    // sprite.draw_bounds calls saved by cached bounds in frame
+    sim_collision_stats_t frame_collision_stats;    // of all ticks in frame
+    sx_vec2* prev_enemy_pos;
+    sx_vec2 prev_player_pos;
+    sx_vec2 prev_saucer_pos;
+    replay_t replay;
+    replay_mode_t replay_mode;
+    bool replay_uncapped;       // playback as fast as possible, without sounds
+    bool replay_skip_render;
     rizz_sprite bullet_sprites[BULLET_TYPE_COUNT];
-    rizz_sprite enemy_sprites[MAX_ENEMIES];
-    rizz_sprite_animclip enemy_clips[MAX_ENEMIES];
+    rizz_sprite* enemy_sprites;
+    rizz_sprite_animclip* enemy_clips;
+    render_cover_holes_t cover_holes;
+    arena_t frame_arena;    // scratch arrays of the frame, reset at each RIZZ_PLUGIN_EVENT_STEP
+    size_t last_frame_arena_size;    // used by the previous frame, the menu is shown before render
     rizz_sprite enemy_explosion_sprite;
     rizz_sprite bounds_explosion_sprite;
     rizz_sprite cover_sprite;
+    rizz_sprite cover_hole_sprite;
+    rizz_sprite overlay_sprite;
+    rizz_sprite player_sprite;
+    rizz_sprite saucer_sprite;
     rizz_asset sounds[SOUND_COUNT];
-    bullet_t bullets[MAX_BULLETS];
-    saucer_t saucer;
-    int num_bullets;
-    int num_bullets_spawned;
-    explosion_t explosions[MAX_BULLETS];
-    int num_explosions;
-    int num_explosions_spawned;
-    player_t player;
     rizz_asset game_atlas;
     rizz_camera cam;
     rizz_input_device keyboard;
     rizz_input_device gamepad;
-    float tile_size;
-    bool enemy_explosion;
-    float enemy_explosion_tm;
-    sx_vec2 enemy_explosion_pos;
-    float enemy_shoot_tm;
-    float enemy_shoot_interval;
-    float game_over_point;
-    explosion_t player_explosion;
-    int player_lives;
-    bool player_died;
-    float heartbeat_tm;
-    int player_score;
     rizz_gfx_stage render_stages[RENDER_STAGE_COUNT];
     rizz_asset font;
-    game_state_t state;
-    int stage;
-    int high_score;
     bool show_dev_menu;
     bool show_debuggers[DEBUGGER_COUNT];
+    bool show_collision_overlay;
 } game_t;
 
 RIZZ_STATE static game_t the_game;
@@ -238,13 +149,13 @@ static void create_sounds(void)
     }
 }
 
-static void save_high_score(void) 
+static void save_high_score(void)
 {
     sx_file f;
     if (sx_file_open(&f, "highscore.dat", SX_FILE_WRITE)) {
         uint32_t sign = SCORE_FOURCC;
         sx_file_write(&f, &sign, sizeof(sign));
-        sx_file_write(&f, &the_game.high_score, sizeof(the_game.high_score));
+        sx_file_write(&f, &the_game.sim.high_score, sizeof(the_game.sim.high_score));
         sx_file_close(&f);
     }
 }
@@ -256,92 +167,15 @@ static void load_high_score(void)
         uint32_t sign;
         sx_file_read(&f, &sign, sizeof(sign));
         if (sign == SCORE_FOURCC) {
-            sx_file_read(&f, &the_game.high_score, sizeof(the_game.high_score));
+            sx_file_read(&f, &the_game.sim.high_score, sizeof(the_game.sim.high_score));
         }
         sx_file_close(&f);
     }
 }
 
-static void refresh_game(void)
-{
-    float tile_size = the_game.tile_size;
-    float half_width = GAME_BOARD_WIDTH * 0.5f;
-    float start_x = -half_width + 2.5f * tile_size;
-    float x = start_x;
-    float y = GAME_BOARD_HEIGHT * 0.5f - tile_size - tile_size*0.5f*((float)the_game.stage);
-
-    for (int i = 0; i < MAX_ENEMIES; i++) {
-        if (i % 11 == 0) {
-            x = start_x;
-            y -= tile_size;
-        }
-
-        the_game.enemies[i].dead = false;
-        the_game.enemies[i].xstep = 0;
-        the_game.enemies[i].shoot_wait_interval = 0;
-        the_game.enemies[i].move_tm = 0;
-        the_game.enemies[i].wait_tm = 0;
-        the_game.enemies[i].move = 0;
-        the_game.enemies[i].pos = sx_vec2f(x, y);
-        the_game.enemies[i].start_pos = the_game.enemies[i].pos;
-        the_game.enemies[i].target_pos = the_game.enemies[i].pos;
-        the_game.enemies[i].dir = 0;
-
-        float dd = ((float)i / (float)MAX_ENEMIES);
-        the_game.enemies[i].wait_duration = dd + ENEMY_WAIT_DURATION;
-        the_game.enemies[i].allow_next_move = true;
-
-        x += tile_size;
-    }
-
-    for (int i = 0; i < NUM_COVERS; i++) {
-        the_game.covers[i].dead = false;
-        the_game.covers[i].health = 100;
-    }
-
-    sx_memset(&the_game.dummy_enemy, 0x0, sizeof(the_game.dummy_enemy));
-    the_game.dummy_enemy.allow_next_move = true;
-    the_game.dummy_enemy.wait_duration = 1.0f + ENEMY_WAIT_DURATION;
-    the_game.dummy_enemy.dead = true;
-
-    player_t* player = &the_game.player;
-    player->bullet_tm = 0;
-    player->pos = sx_vec2f(0, -GAME_BOARD_HEIGHT * 0.5f + the_game.tile_size * 2.0f);
-    player->bullet_tm = PLAYER_BULLET_INTERVAL;
-
-    the_game.num_bullets_spawned = the_game.num_bullets = 0;
-    the_game.num_explosions_spawned = the_game.num_explosions = 0;
-
-    the_game.saucer.dead = true;
-
-    the_sound->stop_all();
-
-    the_game.player_lives = NUM_LIVES;
-    the_game.stage = 0;
-}
-
-rizz_coro_declare(state_control)
-{
-    if (the_game.player_score > the_game.high_score) {
-        the_game.high_score = the_game.player_score;
-        save_high_score();
-    }
-    
-    if (the_game.state == GAME_STATE_GAMEOVER) {
-        the_game.player_score = 0;
-    }
-
-    rizz_coro_wait(GAME_STATE_DURATION);
-    refresh_game();
-    the_game.state = GAME_STATE_INGAME;
-    rizz_coro_end();
-}
-
-
 static void create_enemies()
 {
-    float half_width = GAME_BOARD_WIDTH * 0.5f;
-    float tile_size = the_game.tile_size;
+    float tile_size = the_game.sim.tile_size;
 
     static const rizz_sprite_animclip_frame_desc enemy1_frames[] = { { .name = "enemy1-a.png" },
                                                                      { .name = "enemy1-b.png" },
@@ -354,49 +188,36 @@ static void create_enemies()
                                                                      { 0 } };
 
     // clang-format off
-    static const int layout[MAX_ENEMIES] = {
-        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1
-    };
-
-    static const char* enemy_names[3] = {
+    static const char* enemy_names[ENEMY_KIND_COUNT] = {
         "enemy3",
         "enemy1",
         "enemy2"
     };
 
-    static const int hit_scores[3] = {
-        10,
-        15,
-        20
-    };
-
-    static sound_type_t enemy_explode_sounds[3] = {
-        SOUND_EXPLODE3,
-        SOUND_EXPLODE1,
-        SOUND_EXPLODE2
-    };
-
-    static const rizz_sprite_animclip_frame_desc* frame_descs[3] = {
-        enemy3_frames, 
+    static const rizz_sprite_animclip_frame_desc* frame_descs[ENEMY_KIND_COUNT] = {
+        enemy3_frames,
         enemy1_frames,
         enemy2_frames
     };
     // clang-format on
 
-    float start_x = -half_width + 2.5f * tile_size;
-    float x = start_x;
-    float y = GAME_BOARD_HEIGHT * 0.5f - tile_size;
-    for (int i = 0; i < MAX_ENEMIES; i++) {
-        if (i % 11 == 0) {
-            x = start_x;
-            y -= tile_size;
-        }
+    const int num_enemies = the_game.sim.num_enemies;
+    size_t total_sz =
+        (sizeof(sx_vec2) + sizeof(rizz_sprite) + sizeof(rizz_sprite_animclip)) * num_enemies;
+    uint8_t* buff = sx_malloc(the_game.alloc, total_sz);
+    if (!buff) {
+        sx_out_of_memory();
+        return;
+    }
+    sx_memset(buff, 0x0, total_sz);
+    the_game.prev_enemy_pos = (sx_vec2*)buff;
+    buff += sizeof(sx_vec2) * num_enemies;
+    the_game.enemy_sprites = (rizz_sprite*)buff;
+    buff += sizeof(rizz_sprite) * num_enemies;
+    the_game.enemy_clips = (rizz_sprite_animclip*)buff;
 
-        int enemy = layout[i];
+    for (int i = 0; i < num_enemies; i++) {
+        enemy_kind_t enemy = (enemy_kind_t)the_game.sim.enemies.kind[i];
 
         the_game.enemy_clips[i] = the_2d->sprite.animclip_create(
             &(rizz_sprite_animclip_desc){ .atlas = the_game.game_atlas,
@@ -410,54 +231,23 @@ static void create_enemies()
                                                     .size = sx_vec2f(tile_size * 0.8f, 0),
                                                     .color = sx_colorn((0xffffffff)),
                                                     .clip = the_game.enemy_clips[i] });
-
-        the_game.enemies[i].pos = sx_vec2f(x, y);
-        the_game.enemies[i].start_pos = the_game.enemies[i].pos;
-        the_game.enemies[i].explode_sound = enemy_explode_sounds[enemy];
-
-        float dd = ((float)i / (float)MAX_ENEMIES);
-        the_game.enemies[i].wait_duration = dd + ENEMY_WAIT_DURATION;
-        the_game.enemies[i].allow_next_move = true;
-        the_game.enemies[i].hit_score = hit_scores[enemy];
-
-        switch (enemy) {
-        case 0:
-            the_game.enemies[i].shoot_wait_interval = 1.0f;
-            break;
-        case 1:
-            the_game.enemies[i].shoot_wait_interval = 2.0f;
-            break;
-        case 2:
-            the_game.enemies[i].shoot_wait_interval = 3.0f;
-            break;
-        }
-
-        x += tile_size;
     }
-
-    the_game.dummy_enemy.allow_next_move = true;
-    the_game.dummy_enemy.dead = true;
-    the_game.dummy_enemy.wait_duration = 1.0f + ENEMY_WAIT_DURATION;
 }
 
 static void create_player()
 {
-    player_t* player = &the_game.player;
-    player->sprite = the_2d->sprite.create(&(rizz_sprite_desc){ .name = "player.png",
+    the_game.player_sprite = the_2d->sprite.create(&(rizz_sprite_desc){ .name = "player.png",
                                                              .atlas = the_game.game_atlas,
-                                                             .size = {{the_game.tile_size, 0}},
+                                                             .size = {{the_game.sim.tile_size, 0}},
                                                              .color = sx_colorn(0xffffffff) });
-    player->pos = sx_vec2f(0, -GAME_BOARD_HEIGHT * 0.5f + the_game.tile_size * 2.0f);
-    player->speed = 0.1f;
-    player->bullet_tm = PLAYER_BULLET_INTERVAL;
 }
 
 static void create_bullet_sprites()
 {
     static const char* bullet_names[BULLET_TYPE_COUNT] = { "bullet0.png", "bullet1.png" };
 
-    const float bullet_sizes[BULLET_TYPE_COUNT] = { the_game.tile_size * 0.5f,
-                                                    the_game.tile_size * 0.5f };
+    const float bullet_sizes[BULLET_TYPE_COUNT] = { the_game.sim.tile_size * 0.5f,
+                                                    the_game.sim.tile_size * 0.5f };
     const float bullet_origins[BULLET_TYPE_COUNT] = { -0.5f, 0.5f };
     for (int i = 0; i < BULLET_TYPE_COUNT; i++) {
         the_game.bullet_sprites[i] =
@@ -474,95 +264,195 @@ static void create_explosion_sprites()
     the_game.enemy_explosion_sprite =
         the_2d->sprite.create(&(rizz_sprite_desc){ .name = "explode.png",
                                                 .atlas = the_game.game_atlas,
-                                                .size = sx_vec2f(the_game.tile_size, 0),
+                                                .size = sx_vec2f(the_game.sim.tile_size, 0),
                                                 .color = sx_colorn(0xffffffff) });
     the_game.bounds_explosion_sprite =
         the_2d->sprite.create(&(rizz_sprite_desc){ .name = "explode2.png",
                                                 .atlas = the_game.game_atlas,
-                                                .size = sx_vec2f(the_game.tile_size, 0),
+                                                .size = sx_vec2f(the_game.sim.tile_size, 0),
                                                 .origin = sx_vec2f(0, -0.5f) });
 }
 
-static void create_bullet(sx_vec2 pos, bullet_type_t type)
+static rizz_sprite explosion_sprite(explosion_type_t type)
 {
-    sx_assert(type < BULLET_TYPE_COUNT);
+    return type == EXPLOSION_TYPE_BOUNDS ? the_game.bounds_explosion_sprite
+                                         : the_game.enemy_explosion_sprite;
+}
 
-    static const float bullet_speeds[BULLET_TYPE_COUNT] = { 1.5f, 0.75f };
-    static const int bullet_damages[BULLET_TYPE_COUNT] = { 10, 20 };
+static void create_saucer(void)
+{
+    the_game.saucer_sprite =
+        the_2d->sprite.create(&(rizz_sprite_desc){ .name = "saucer.png",
+                                                .atlas = the_game.game_atlas,
+                                                .size = sx_vec2f(the_game.sim.tile_size, 0) });
+}
 
-    bullet_t bullet = { .pos = pos,
-                        .type = type,
-                        .sprite = the_game.bullet_sprites[type],
-                        .damage = bullet_damages[type],
-                        .speed =
-                            bullet_speeds[type] * (type == BULLET_TYPE_PLAYER ? 1.0f : -1.0f) };
+static void create_covers(void)
+{
+    float tile_size = the_game.sim.cover_size;
+    the_game.cover_sprite = the_2d->sprite.create(&(rizz_sprite_desc){ .name = "cover.png",
+                                                                       .atlas = the_game.game_atlas,
+                                                                       .size = sx_vec2f(tile_size, 0),
+                                                                       .origin = sx_vec2f(-0.5f, -0.5f) });
 
-    ++the_game.num_bullets_spawned;
+    // any opaque image works for the holes, it's stretched and tinted black
+    the_game.cover_hole_sprite =
+        the_2d->sprite.create(&(rizz_sprite_desc){ .name = "bullet0.png",
+                                                .atlas = the_game.game_atlas,
+                                                .size = sx_vec2f(1.0f, 1.0f),
+                                                .color = sx_colorn(0xff000000) });
+    the_game.overlay_sprite =
+        the_2d->sprite.create(&(rizz_sprite_desc){ .name = "bullet0.png",
+                                                .atlas = the_game.game_atlas,
+                                                .size = sx_vec2f(1.0f, 1.0f) });
+}
 
-    int index;
-    if (the_game.num_bullets < MAX_BULLETS) {
-        index = the_game.num_bullets;
-        ++the_game.num_bullets;
-    } else {
-        index = the_game.num_bullets_spawned % MAX_BULLETS;
+// the hole runs of covers are kept between frames, they are only updated for the changed rows
+static void create_cover_holes(void)
+{
+    int num_covers = the_game.sim.config.num_covers;
+    void* buff = sx_malloc(the_game.alloc, render_cover_holes_data_size(num_covers));
+    if (!buff) {
+        sx_out_of_memory();
+        return;
     }
+    render_cover_holes_init(&the_game.cover_holes, buff, num_covers);
+}
 
-    the_game.bullets[index] = bullet;
+// arena space of the buffers, with the alignment padding of each array
+static size_t render_buffers_size(int count)
+{
+    return (sizeof(sx_mat3) + sizeof(rizz_sprite) + sizeof(sx_color) + sizeof(int) +
+            sizeof(bullet_type_t) + sizeof(explosion_type_t)) * (size_t)count +
+           6 * ARENA_ALIGN;
 }
 
-static void create_explosion(sx_vec2 pos, rizz_sprite sprite)
+// the buffer moves, so the arena must be empty. grows by half again as much as asked, so frames
+// that get bigger a bit at a time don't reallocate each time
+static bool grow_frame_arena(size_t size)
 {
-    explosion_t explosion = { .pos = pos, .sprite = sprite };
-    ++the_game.num_explosions_spawned;
+    arena_t* arena = &the_game.frame_arena;
+    sx_assert(arena->offset == 0);
+
+    size += size / 2;
+    void* buff = sx_realloc(the_game.alloc, arena->buff, size);
+    if (!buff) {
+        sx_out_of_memory();
+        return false;
+    }
+    arena_init(arena, buff, size);
+    rizz_log_info("frame arena grown to %d KB", (int)(size / 1024));
+    return true;
+}
 
-    int index;
-    if (the_game.num_explosions < MAX_BULLETS) {
-        index = the_game.num_explosions;
-        ++the_game.num_explosions;
-    } else {
-        index = the_game.num_explosions_spawned % MAX_BULLETS;
+// render is the first to take from the arena in the frame, so it can grow it to fit the buffers
+// returns false only when out of memory
+static bool alloc_render_buffers(render_buffers_t* rb, int count)
+{
+    arena_t* arena = &the_game.frame_arena;
+    size_t size = render_buffers_size(count);
+    if (arena->offset + size > arena->size && !grow_frame_arena(arena->offset + size)) {
+        return false;
     }
 
-    the_game.explosions[index] = explosion;
+    rb->mats = arena_alloc(arena, sizeof(sx_mat3) * count);
+    rb->sprites = arena_alloc(arena, sizeof(rizz_sprite) * count);
+    rb->colors = arena_alloc(arena, sizeof(sx_color) * count);
+    rb->enemy_indices = arena_alloc(arena, sizeof(int) * count);
+    rb->bullet_types = arena_alloc(arena, sizeof(bullet_type_t) * count);
+    rb->explosion_types = arena_alloc(arena, sizeof(explosion_type_t) * count);
+    rb->count = count;
+    sx_assert(rb->explosion_types);    // the padding is part of the size
+    return true;
 }
 
-static void create_saucer(void)
+// allocations that didn't fit in the last frame raised the peak over the size, the arena grows to
+// it once they are released
+static void reset_frame_arena(void)
 {
-    rizz_sprite sprite =
-        the_2d->sprite.create(&(rizz_sprite_desc){ .name = "saucer.png",
-                                                .atlas = the_game.game_atlas,
-                                                .size = sx_vec2f(the_game.tile_size, 0) });
-    the_game.saucer = (saucer_t){ .dead = true,
-                                  .sprite = sprite,
-                                  .wait_duration = 30.0f + (sx_rng_genf(&the_game.rng) * 20.0f - 10.0f),
-                                  .hit_score = 100 };
+    arena_t* arena = &the_game.frame_arena;
+    the_game.last_frame_arena_size = arena->offset;
+    arena_reset(arena);
+    if (arena->peak > arena->size) {
+        grow_frame_arena(arena->peak);
+    }
 }
 
-static void remove_bullet(int index)
+static void check_bounds(const char* name, rizz_sprite sprite, sx_rect cached)
 {
-    if (index < the_game.num_bullets - 1) {
-        the_game.bullets[index] = the_game.bullets[the_game.num_bullets - 1];
+    sx_rect rc = the_2d->sprite.draw_bounds(sprite);
+    const float eps = 1e-4f;
+    if (sx_abs(rc.xmin - cached.xmin) > eps || sx_abs(rc.ymin - cached.ymin) > eps ||
+        sx_abs(rc.xmax - cached.xmax) > eps || sx_abs(rc.ymax - cached.ymax) > eps) {
+        rizz_log_warn("cached bounds of '%s' does not match the sprite", name);
     }
+}
 
-    --the_game.num_bullets;
+// collision uses the bounds cached in the simulation, they are checked against the sprites once
+// here. both frames of enemy animclips have the same rect in the atlas, so the bounds don't change
+// with the frames and enemies are only checked with their first frame
+static void check_sim_bounds(void)
+{
+    const sim_state_t* sim = &the_game.sim;
+    bool checked[ENEMY_KIND_COUNT] = { 0 };
+    for (int i = 0; i < sim->num_enemies && the_game.enemy_sprites; i++) {
+        enemy_kind_t kind = (enemy_kind_t)sim->enemies.kind[i];
+        if (!checked[kind]) {
+            check_bounds("enemy", the_game.enemy_sprites[i], sim->bounds.enemies[kind]);
+            checked[kind] = true;
+        }
+    }
+
+    for (int i = 0; i < BULLET_TYPE_COUNT; i++) {
+        check_bounds("bullet", the_game.bullet_sprites[i], sim->bounds.bullets[i]);
+    }
+    check_bounds("player", the_game.player_sprite, sim->bounds.player);
+    check_bounds("cover", the_game.cover_sprite, sim->bounds.cover);
+    check_bounds("saucer", the_game.saucer_sprite, sim->bounds.saucer);
 }
 
-static void create_covers(void)
+// sprites are sized by the tile size of simulation, so they are recreated with it
+static void create_sprites(void)
+{
+    // TODO: creating sprites should be easier (from data)
+    //
+    create_enemies();
+    create_player();
+    create_bullet_sprites();
+    create_explosion_sprites();
+    create_covers();
+    create_saucer();
+    create_cover_holes();
+    check_sim_bounds();
+}
+
+static void destroy_sprites(void)
 {
-    float tile_size = GAME_BOARD_WIDTH / 9.0f;
-    float half_width = GAME_BOARD_WIDTH * 0.5f;
-    int count = 0;
-    for (float x = -half_width + tile_size; x < half_width && count < NUM_COVERS;
-         x += tile_size * 2.0f) {
-        cover_t* cover = &the_game.covers[count++];
-        cover->pos = sx_vec2f(x, -GAME_BOARD_HEIGHT * 0.5f + tile_size * 2.0f);
-        cover->health = 100;
+    for (int i = 0; i < the_game.sim.num_enemies; i++) {
+        the_2d->sprite.animclip_destroy(the_game.enemy_clips[i]);
+        the_2d->sprite.destroy(the_game.enemy_sprites[i]);
     }
+    // prev_enemy_pos is the start of enemy arrays block
+    sx_free(the_game.alloc, the_game.prev_enemy_pos);
+    the_game.prev_enemy_pos = NULL;
+    the_game.enemy_sprites = NULL;
+    the_game.enemy_clips = NULL;
 
-    the_game.cover_sprite = the_2d->sprite.create(&(rizz_sprite_desc){ .name = "cover.png",
-                                                                       .atlas = the_game.game_atlas,
-                                                                       .size = sx_vec2f(tile_size, 0),
-                                                                       .origin = sx_vec2f(-0.5f, -0.5f) });
+    for (int i = 0; i < BULLET_TYPE_COUNT; i++) {
+        the_2d->sprite.destroy(the_game.bullet_sprites[i]);
+    }
+
+    the_2d->sprite.destroy(the_game.enemy_explosion_sprite);
+    the_2d->sprite.destroy(the_game.bounds_explosion_sprite);
+    the_2d->sprite.destroy(the_game.cover_sprite);
+    the_2d->sprite.destroy(the_game.cover_hole_sprite);
+    the_2d->sprite.destroy(the_game.overlay_sprite);
+    the_2d->sprite.destroy(the_game.player_sprite);
+    the_2d->sprite.destroy(the_game.saucer_sprite);
+
+    // rows are the start of cover holes block
+    sx_free(the_game.alloc, the_game.cover_holes.rows);
+    sx_memset(&the_game.cover_holes, 0x0, sizeof(the_game.cover_holes));
 }
 
 static bool init()
@@ -571,6 +461,13 @@ static bool init()
 
     sx_rng_seed_time(&the_game.rng );
 
+    void* arena_buff = sx_malloc(the_game.alloc, FRAME_ARENA_SIZE);
+    if (!arena_buff) {
+        sx_out_of_memory();
+        return false;
+    }
+    arena_init(&the_game.frame_arena, arena_buff, FRAME_ARENA_SIZE);
+
     the_game.render_stages[RENDER_STAGE_GAME] = the_gfx->stage_register("game", (rizz_gfx_stage){ .id = 0 });
     the_game.render_stages[RENDER_STAGE_UI] = the_gfx->stage_register("ui", the_game.render_stages[RENDER_STAGE_GAME]);
     sx_assert(the_game.render_stages[RENDER_STAGE_GAME].id);
@@ -612,19 +509,19 @@ static bool init()
     the_game.font = the_asset->load("font", "/assets/fonts/5x5_pixel.ttf",
                                     &(rizz_font_load_params){ 0 }, 0, the_game.alloc, 0);
 
-    // TODO: creating sprites should be easier (from data)
-    //
-    the_game.tile_size = GAME_BOARD_WIDTH / 15.0f;
-    the_game.enemy_shoot_interval = ENEMY_SHOOT_INTERVAL;
-    the_game.player_lives = NUM_LIVES;
+    // gameplay
+    the_game.jobs = (sim_jobs_t){ .dispatch = the_core->job_dispatch,
+                                  .wait_and_del = the_core->job_wait_and_del };
+    the_game.sim_config = sim_default_config();
+    if (!sim_init(&the_game.sim, the_game.alloc, &the_game.sim_config,
+                  sx_rng_gen(&the_game.rng))) {
+        return false;
+    }
+    the_game.sim.jobs = &the_game.jobs;
+    the_game.tick_rate = DEFAULT_TICK_RATE;
 
-    create_enemies();
-    create_player();
-    create_bullet_sprites();
-    create_explosion_sprites();
-    create_covers();
+    create_sprites();
     create_sounds();
-    create_saucer();
 
     // first bus (#0) is used for sfx
     // second bus (#1) is used for heart-beat music effect
@@ -638,523 +535,217 @@ static bool init()
     return true;
 }
 
-static void shutdown() 
+static void shutdown()
 {
     the_asset->unload(the_game.game_atlas);
     the_asset->unload(the_game.font);
     for (int i = 0; i < SOUND_COUNT; i++) {
         the_asset->unload(the_game.sounds[i]);
     }
-    for (int i = 0; i < MAX_ENEMIES; i++) {
-        the_2d->sprite.animclip_destroy(the_game.enemy_clips[i]);
-        the_2d->sprite.destroy(the_game.enemy_sprites[i]);
-    }
-
-    for (int i = 0; i < BULLET_TYPE_COUNT; i++) {
-        the_2d->sprite.destroy(the_game.bullet_sprites[i]);
+    if (!the_game.sim_failed) {
+        destroy_sprites();
     }
-
-    the_2d->sprite.destroy(the_game.enemy_explosion_sprite);
-    the_2d->sprite.destroy(the_game.bounds_explosion_sprite);
-    the_2d->sprite.destroy(the_game.cover_sprite);
-    the_2d->sprite.destroy(the_game.player.sprite);
-    the_2d->sprite.destroy(the_game.saucer.sprite);
+    sim_release(&the_game.sim, the_game.alloc);
+    replay_release(&the_game.replay, the_game.alloc);
+    sx_free(the_game.alloc, the_game.frame_arena.buff);
     the_core->trace_alloc_destroy(the_game.alloc);
 }
 
-static void update_enemy(enemy_t* e, float dt)
+// applies side-effects of the last simulation step
+static void process_sim_events(const sim_state_t* sim, bool play_sounds)
 {
-    if (!e->move && e->allow_next_move) {
-        e->wait_tm += dt;
-        if (e->wait_tm >= e->wait_duration) {
-            e->wait_tm = 0;
-            switch (e->dir) {
-            case ENEMY_MOVEMENT_DOWN:
-                e->target_pos = sx_vec2f(e->pos.x, e->pos.y - the_game.tile_size);
-                break;
-            case ENEMY_MOVEMENT_LEFT:
-                e->target_pos = sx_vec2f(e->pos.x - the_game.tile_size, e->pos.y);
-                break;
-            case ENEMY_MOVEMENT_RIGHT:
-                e->target_pos = sx_vec2f(e->pos.x + the_game.tile_size, e->pos.y);
-                break;
-            }
-            e->move = true;
-        }
-    } else if (e->allow_next_move) {
-        // move to target
-        float t = e->move_tm / ENEMY_TILE_MOVE_DURATION;
-        t = sx_min(e->move_tm, 1.0f);
-        e->pos = sx_vec2_lerp(e->start_pos, e->target_pos, t);
-        e->move_tm += dt;
-
-        if (t >= 1.0f) {
-            if (e->dir == ENEMY_MOVEMENT_LEFT) {
-                --e->xstep;
-                if (e->xstep <= -2) {
-                    e->dir = ENEMY_MOVEMENT_DOWN;
-                }
-            } else if (e->dir == ENEMY_MOVEMENT_RIGHT) {
-                ++e->xstep;
-                if (e->xstep >= 2) {
-                    e->dir = ENEMY_MOVEMENT_DOWN;
-                }
-            } else if (e->dir == ENEMY_MOVEMENT_DOWN) {
-                e->dir = e->xstep < 0 ? ENEMY_MOVEMENT_RIGHT : ENEMY_MOVEMENT_LEFT;
+    for (int i = 0; i < sim->num_events; i++) {
+        const sim_event_t* e = &sim->events[i];
+        switch (e->type) {
+        case SIM_EVENT_SOUND:
+            if (play_sounds) {
+                the_sound->play(the_sound->source_get(the_game.sounds[e->sound]), e->bus, 1.0f, 0,
+                                false);
             }
-
-            e->move_tm = 0;
-            e->start_pos = e->target_pos;
-            e->move = false;
-            e->allow_next_move = false;
+            break;
+        case SIM_EVENT_STOP_SOUNDS:
+            the_sound->stop_all();
+            break;
+        case SIM_EVENT_HIGH_SCORE:
+            save_high_score();
+            break;
+        case SIM_EVENT_STATE:
+            break;
         }
     }
-
-    if (!e->dead && e->pos.y <= (the_game.player.pos.y + the_game.tile_size*0.5f)) {
-        the_game.state = GAME_STATE_GAMEOVER;
-        rizz_coro_invoke(state_control, NULL);
-    }
 }
 
-static void spawn_saucer(void)
+static void save_prev_positions(void)
 {
-    float side = sx_sign(sx_rng_genf(&the_game.rng) * 2.0f - 1.0f);
-    if (side == 0) {
-        side = 1.0f;
-    }
-
-    saucer_t* saucer = &the_game.saucer;
-    saucer->pos.x = side * (GAME_BOARD_WIDTH * 0.5f + the_game.tile_size);
-    saucer->pos.y = GAME_BOARD_HEIGHT * 0.5f - the_game.tile_size;
-    saucer->speed = -side * 0.3f;
-    saucer->wait_duration = 30.0f + (sx_rng_genf(&the_game.rng) * 20.0f - 10.0f);
-    saucer->dead = false;
-
-    the_sound->play(the_sound->source_get(the_game.sounds[SOUND_SAUCER]), 0, 1.0f, 0, false);
+    const sim_state_t* sim = &the_game.sim;
+    sx_memcpy(the_game.prev_enemy_pos, sim->enemies.pos, sizeof(sx_vec2) * sim->num_enemies);
+    the_game.prev_player_pos = sim->player.pos;
+    the_game.prev_saucer_pos = sim->saucer.pos;
 }
 
-static void update_player(float dt)
+// starts a new game with the given config and seed, keeps high score
+// returns false if neither `config` nor the default config could be allocated, the game then waits
+// for another restart without a simulation
+static bool restart_sim(const sim_config_t* config, uint32_t seed)
 {
-    if (the_game.player_died) {
-        return;
-    }
-
-    player_t* player = &the_game.player;
-    float speed = 0.4f;
-    if (the_input->get_bool(KEY_LEFT)) {
-        float left_limit = -GAME_BOARD_WIDTH * 0.5f +
-                           sx_rect_width(the_2d->sprite.draw_bounds(the_game.player.sprite)) * 0.5f +
-                           the_game.tile_size * 0.1f;
-        player->pos.x -= dt * speed;
-        player->pos.x = sx_max(left_limit, player->pos.x);
-    }
-
-    if (the_input->get_bool(KEY_RIGHT)) {
-        float right_limit = GAME_BOARD_WIDTH * 0.5f -
-                            sx_rect_width(the_2d->sprite.draw_bounds(the_game.player.sprite)) * 0.5f -
-                            the_game.tile_size * 0.1f;
-        player->pos.x += dt * speed;
-        player->pos.x = sx_min(right_limit, player->pos.x);
-    }
-
-    { // analog stick
-        float right_limit = GAME_BOARD_WIDTH * 0.5f -
-                            sx_rect_width(the_2d->sprite.draw_bounds(the_game.player.sprite)) * 0.5f -
-                            the_game.tile_size * 0.1f;
-        float left_limit = -GAME_BOARD_WIDTH * 0.5f +
-                           sx_rect_width(the_2d->sprite.draw_bounds(the_game.player.sprite)) * 0.5f +
-                           the_game.tile_size * 0.1f;
-        float movex_analog = the_input->get_float(KEY_MOVEX_ANALOG);
-        movex_analog = sx_sign(movex_analog) * sx_easeout_quad(sx_abs(movex_analog));
-        speed = movex_analog * speed;
-        player->pos.x += dt * speed;
-        player->pos.x = sx_clamp(player->pos.x, left_limit, right_limit);
+    int high_score = the_game.sim.high_score;
+    if (!the_game.sim_failed) {
+        destroy_sprites();
     }
-    
-
-    player->bullet_tm += dt;
-    if (the_input->get_bool(KEY_SHOOT) && !the_game.enemy_explosion) {
-        if (player->bullet_tm > PLAYER_BULLET_INTERVAL) {
-            create_bullet(
-                sx_vec2f(player->pos.x,
-                         player->pos.y +
-                             sx_rect_height(the_2d->sprite.draw_bounds(player->sprite)) * 0.5f),
-                BULLET_TYPE_PLAYER);
-            player->bullet_tm = 0;
-
-            the_sound->play(the_sound->source_get(the_game.sounds[SOUND_SHOOT]), 0, 1.0f, 0, false);
+    sim_release(&the_game.sim, the_game.alloc);
+    if (!sim_init(&the_game.sim, the_game.alloc, config, seed)) {
+        rizz_log_warn("could not allocate the simulation, falling back to default config");
+        the_game.sim_config = sim_default_config();
+        if (!sim_init(&the_game.sim, the_game.alloc, &the_game.sim_config, seed)) {
+            rizz_log_error("could not allocate the simulation with default config");
+            the_game.sim_failed = true;
+            the_game.sim.high_score = high_score;
+            the_sound->stop_all();
+            return false;
         }
     }
+    the_game.sim_failed = false;
+    create_sprites();
+    the_game.sim.jobs = &the_game.jobs;
+    the_game.sim.high_score = high_score;
+    the_game.tick_accum = 0;
+    save_prev_positions();
+    the_sound->stop_all();
+    return true;
 }
 
-static void check_bullet_collision_cb(int start, int end, int thrd_index, void* user)
+static void start_recording(void)
 {
-    collision_data_t* cdata = user;
-
-    if (cdata->hit_index != -1) {
+    uint32_t seed = sx_rng_gen(&the_game.rng);
+    if (!restart_sim(&the_game.sim_config, seed)) {
         return;
     }
-
-    bullet_t* bullet = &the_game.bullets[cdata->bullet_index];
-    sx_rect bullet_rc = sx_rect_move(the_2d->sprite.draw_bounds(bullet->sprite), bullet->pos);
-    c2AABB bullet_aabb = { { bullet_rc.xmin, bullet_rc.ymax }, { bullet_rc.xmax, bullet_rc.ymin } };
-
-    for (int i = start; i < end; i++) {
-        if (the_game.enemies[i].dead) {
-            continue;
-        }
-
-        sx_rect enemy_rc = sx_rect_move(the_2d->sprite.draw_bounds(the_game.enemy_sprites[i]),
-                                        the_game.enemies[i].pos);
-        c2AABB enemy_aabb = { { enemy_rc.xmin, enemy_rc.ymax }, { enemy_rc.xmax, enemy_rc.ymin } };
-        if (c2AABBtoAABB(bullet_aabb, enemy_aabb)) {
-            cdata->hit_index = i;
-            break;
-        }
-    }
+    replay_begin(&the_game.replay, &the_game.sim.config, seed, the_game.tick_rate);
+    the_game.replay_mode = REPLAY_MODE_RECORD;
 }
 
-static void kill_player(void)
+static void stop_recording(void)
 {
-    sx_assert(!the_game.player_died);
-
-    the_game.player_died = true;
-    the_game.player_explosion.pos = the_game.player.pos;
-    --the_game.player_lives;
+    sx_assert(the_game.replay_mode == REPLAY_MODE_RECORD);
 
-    the_sound->play(the_sound->source_get(the_game.sounds[SOUND_EXPLODE4]), 0, 1.0f, 0, false);
+    the_game.replay.final_score = the_game.sim.player_score;
+    the_game.replay.final_checksum = sim_checksum(&the_game.sim);
+    if (replay_save(&the_game.replay, REPLAY_FILE)) {
+        rizz_log_info("replay saved: %s (%d ticks)", REPLAY_FILE, the_game.replay.num_ticks);
+    } else {
+        rizz_log_warn("could not save replay: %s", REPLAY_FILE);
+    }
+    the_game.replay_mode = REPLAY_MODE_NONE;
 }
 
-static void kill_saucer(void)
+static void start_playback(void)
 {
-    saucer_t* saucer = &the_game.saucer;
-
-    saucer->dead = true;
-
-    the_game.enemy_explosion = true;
-    the_game.enemy_explosion_tm = 0;
-    the_game.enemy_explosion_pos = saucer->pos;
-
-    the_game.player_score += saucer->hit_score;
+    if (!replay_load(&the_game.replay, the_game.alloc, REPLAY_FILE)) {
+        rizz_log_warn("could not load replay: %s", REPLAY_FILE);
+        return;
+    }
 
-    the_sound->play(the_sound->source_get(the_game.sounds[SOUND_BONUS]), 1, 1.0f, 0, false);
+    if (!restart_sim(&the_game.replay.config, the_game.replay.seed)) {
+        return;
+    }
+    the_game.tick_rate = the_game.replay.tick_rate;
+    the_game.replay_mode = REPLAY_MODE_PLAYBACK;
 }
 
-static void update_bullets(float dt)
+static void stop_playback(void)
 {
-    // TODO: remove c2AABB
-    for (int i = 0; i < the_game.num_bullets; i++) {
-        bullet_t* bullet = &the_game.bullets[i];
-
-        bullet->pos.y += bullet->speed * dt;
-
-        if (bullet->pos.y >= GAME_BOARD_HEIGHT * 0.5f ||
-            bullet->pos.y <= -GAME_BOARD_HEIGHT * 0.5f) {
-
-            if (bullet->pos.y <= -GAME_BOARD_HEIGHT * 0.5f) {
-                create_explosion(sx_vec2f(bullet->pos.x, -GAME_BOARD_HEIGHT * 0.5f),
-                                 the_game.bounds_explosion_sprite);
-            }
-
-            remove_bullet(i);
-            i--;
-            continue;
-        }
-
-        sx_rect bullet_rc = sx_rect_move(the_2d->sprite.draw_bounds(bullet->sprite), bullet->pos);
-        c2AABB bullet_aabb = { { bullet_rc.xmin, bullet_rc.ymax },
-                               { bullet_rc.xmax, bullet_rc.ymin } };
-
-        // check collision with the world based on bullet type
-        if (bullet->type == BULLET_TYPE_PLAYER) {
-            collision_data_t cdata = { .bullet_index = i, .hit_index = -1 };
-            sx_job_t job = the_core->job_dispatch(MAX_ENEMIES, check_bullet_collision_cb, &cdata,
-                                                  SX_JOB_PRIORITY_NORMAL, 0);
-            the_core->job_wait_and_del(job);
-            if (cdata.hit_index != -1) {
-                the_game.enemies[cdata.hit_index].dead = true;
-
-                // enter explosion state
-                the_game.enemy_explosion = true;
-                the_game.enemy_explosion_tm = 0;
-                the_game.enemy_explosion_pos = the_game.enemies[cdata.hit_index].pos;
-
-                the_game.player_score += the_game.enemies[cdata.hit_index].hit_score;
-
-                the_sound->play(
-                    the_sound->source_get(
-                        the_game.sounds[the_game.enemies[cdata.hit_index].explode_sound]),
-                    0, 1.0f, 0, false);
-
-                remove_bullet(i);
-                i--;
-                continue;
-            }
-
-            // collision of the player bullet with saucer
-            saucer_t* saucer = &the_game.saucer;
-            if (!saucer->dead) {
-                sx_rect saucer_rc =
-                    sx_rect_move(the_2d->sprite.draw_bounds(saucer->sprite), saucer->pos);
-                c2AABB saucer_aabb = { { saucer_rc.xmin, saucer_rc.ymax },
-                                       { saucer_rc.xmax, saucer_rc.ymin } };
-                if (c2AABBtoAABB(saucer_aabb, bullet_aabb)) {
-                    kill_saucer();
-                    remove_bullet(i);
-                    i--;
-                    continue;
-                }
-            }
-        } else if (bullet->type == BULLET_TYPE_ALIEN1) {
-            // check collision with player
-            sx_rect player_rc =
-                sx_rect_move(the_2d->sprite.draw_bounds(the_game.player.sprite), the_game.player.pos);
-            c2AABB player_aabb = { { player_rc.xmin, player_rc.ymax },
-                                   { player_rc.xmax, player_rc.ymin } };
-            if (c2AABBtoAABB(bullet_aabb, player_aabb) && !the_game.player_died) {
-                kill_player();
-
-                remove_bullet(i);
-                i--;
-                continue;
-            }
-        }
-
-        // collision with covers
-        {
-            bool bullet_hit = false;
-            for (int ic = 0; ic < NUM_COVERS; ic++) {
-                cover_t* cover = &the_game.covers[ic];
-                if (!cover->dead) {
-                    sx_rect cover_rc =
-                        sx_rect_move(the_2d->sprite.draw_bounds(the_game.cover_sprite), cover->pos);
-                    c2AABB cover_aabb = { { cover_rc.xmin, cover_rc.ymax },
-                                          { cover_rc.xmax, cover_rc.ymin } };
-                    if (c2AABBtoAABB(bullet_aabb, cover_aabb)) {
-                        bullet_hit = true;
-                        cover->health -= bullet->damage;
-                        cover->health = sx_max(cover->health, 0);
-                        create_explosion(bullet->pos, the_game.enemy_explosion_sprite);
-                        the_sound->play(the_sound->source_get(the_game.sounds[SOUND_HIT]), 0, 1.0f,
-                                        0, false);
-                        if (cover->health <= 0) {
-                            cover->dead = true;
-                        }
-                        break;
-                    }
-                }
-            }
-
-            if (bullet_hit) {
-                remove_bullet(i);
-                i--;
-                continue;
-            }
-        }
-
-        // collision with other bullets
-        {
-            for (int ib = 0; ib < the_game.num_bullets; ib++) {
-                if (i != ib) {
-                    bullet_t* bullet2 = &the_game.bullets[ib];
-                    sx_rect bullet2_rc =
-                        sx_rect_move(the_2d->sprite.draw_bounds(bullet2->sprite), bullet2->pos);
-                    c2AABB bullet2_aabb = { { bullet2_rc.xmin, bullet2_rc.ymax },
-                                            { bullet2_rc.xmax, bullet2_rc.ymin } };
-                    if (c2AABBtoAABB(bullet_aabb, bullet2_aabb)) {
-                        create_explosion(sx_vec2_mulf(sx_vec2_add(bullet->pos, bullet2->pos), 0.5f),
-                                         the_game.enemy_explosion_sprite);
-                        remove_bullet(ib);
-                        remove_bullet(i);
-                        the_sound->play(the_sound->source_get(the_game.sounds[SOUND_HIT]), 0, 1.0f,
-                                        0, false);
-                        i--;
-                    }
-                }
-            }
-        }
+    uint32_t checksum = sim_checksum(&the_game.sim);
+    if (checksum == the_game.replay.final_checksum) {
+        rizz_log_info("replay finished: score %d, checksum 0x%08x", the_game.sim.player_score,
+                      checksum);
+    } else {
+        rizz_log_warn("replay mismatch: checksum 0x%08x, recorded 0x%08x", checksum,
+                      the_game.replay.final_checksum);
     }
+    the_game.replay_mode = REPLAY_MODE_NONE;
+    the_game.replay_skip_render = false;
 }
 
-static void update_explosions(float dt)
+// fetches the input of the next tick from the devices or the replay
+// returns false when the replay is finished
+static bool tick_input(sim_input_t* input)
 {
-    for (int i = 0; i < the_game.num_explosions; i++) {
-        explosion_t* explosion = &the_game.explosions[i];
-        if (explosion->wait_tm >= ENEMY_EXPLODE_TIME) {
-            if (i < the_game.num_explosions - 1) {
-                the_game.explosions[i] = the_game.explosions[the_game.num_explosions - 1];
-            }
-
-            --the_game.num_explosions;
-            explosion->wait_tm = 0;
+    if (the_game.replay_mode == REPLAY_MODE_PLAYBACK) {
+        if (!replay_next(&the_game.replay, input)) {
+            stop_playback();
+            return false;
         }
+        return true;
+    }
 
-        explosion->wait_tm += dt;
+    *input = (sim_input_t){ .left = the_input->get_bool(KEY_LEFT),
+                            .right = the_input->get_bool(KEY_RIGHT),
+                            .shoot = the_input->get_bool(KEY_SHOOT),
+                            .movex = the_input->get_float(KEY_MOVEX_ANALOG) };
+    if (the_game.replay_mode == REPLAY_MODE_RECORD) {
+        replay_record(&the_game.replay, the_game.alloc, input);
     }
+    return true;
 }
 
-static int check_collision_with_covers(enemy_t* e) 
+static void tick(const sim_input_t* input, float tick_dt, bool play_sounds)
 {
-    if (e->pos.y > 0) {
-        return -1;
-    }
-
-    sx_rect enemy_rc = sx_rect_move(the_2d->sprite.draw_bounds(the_game.cover_sprite), e->pos);
-    c2AABB enemy_aabb = { { enemy_rc.xmin, enemy_rc.ymax }, { enemy_rc.xmax, enemy_rc.ymin } };
-
-    for (int i = 0; i < NUM_COVERS; i++) {
-        cover_t* cover = &the_game.covers[i];
-        if (cover->dead) {
-            continue;
-        }
-
-        sx_rect cover_rc = sx_rect_move(the_2d->sprite.draw_bounds(the_game.cover_sprite), cover->pos);
-        c2AABB cover_aabb = { { cover_rc.xmin, cover_rc.ymax }, { cover_rc.xmax, cover_rc.ymin } };
-        
-        if (c2AABBtoAABB(enemy_aabb, cover_aabb)) {
-            return i;
-        }
+    save_prev_positions();
+    sim_step(&the_game.sim, input, tick_dt);
+    the_game.frame_bounds_lookups += the_game.sim.num_bounds_lookups;
+    sim_collision_stats_add(&the_game.frame_collision_stats, &the_game.sim.collision_stats);
+
+    if (the_game.sim.state == GAME_STATE_INGAME) {
+        the_2d->sprite.animclip_update_batch(the_game.enemy_clips, the_game.sim.num_enemies,
+                                             the_game.sim.enemy_dt);
     }
 
-    return -1;
+    process_sim_events(&the_game.sim, play_sounds);
 }
 
+// simulation runs with fixed time steps, frame time is accumulated and consumed by whole ticks
+// the remainder is used to interpolate positions for rendering
 static void update(float dt)
 {
-    if (the_game.state != GAME_STATE_INGAME) {
+    if (the_game.sim_failed) {
         return;
     }
 
     rizz_profile_begin(UPDATE, 0);
 
-    float dtp = dt;
-    float dte;
+    const float tick_dt = 1.0f / (float)the_game.tick_rate;
+    sim_input_t input;
 
-    if (the_game.player_died) {
-        dt = 0;
-    }
-
-    update_player(dt);
-
-    // update enemies
-    {
-        int alive_enemies[MAX_ENEMIES];
-        int num_alive = 0;
-        for (int i = 0; i < MAX_ENEMIES; i++) {
-            enemy_t* e = &the_game.enemies[i];
-            if (!e->dead) {
-                alive_enemies[num_alive++] = i;
-            }
-        }
-
-        if (num_alive == 0) {
-            // player won the game
-            the_game.state = GAME_STATE_WIN;
-            ++the_game.stage;
-            rizz_coro_invoke(state_control, NULL);
-        }
-
-        float speed = sx_lerp(1.0f, 4.0f, 1.0f - ((float)num_alive / (float)MAX_ENEMIES));
-        dte = the_game.enemy_explosion ? 0.0f : (dt * speed);
-        the_2d->sprite.animclip_update_batch(the_game.enemy_clips, MAX_ENEMIES, dte);
+    the_game.frame_bounds_lookups = 0;
+    sx_memset(&the_game.frame_collision_stats, 0x0, sizeof(the_game.frame_collision_stats));
+    the_game.sim.time_collisions = the_game.show_debuggers[DEBUGGER_COLLISIONS];
 
-        for (int i = 0; i < num_alive; i++) {
-            enemy_t* e = &the_game.enemies[alive_enemies[i]];
-            update_enemy(e, dte);
+    if (the_game.replay_mode == REPLAY_MODE_PLAYBACK && the_game.replay_uncapped) {
+        // not bound to frame time, run as many ticks as we can
+        uint64_t start_tm = sx_tm_now();
+        while (sx_tm_sec(sx_tm_since(start_tm)) < REPLAY_UNCAPPED_FRAME_BUDGET &&
+               tick_input(&input)) {
+            tick(&input, tick_dt, false);
         }
-        update_enemy(&the_game.dummy_enemy, dte);
-
-        if (!the_game.dummy_enemy.allow_next_move) {
-            for (int i = 0; i < num_alive; i++) {
-                the_game.enemies[alive_enemies[i]].allow_next_move = true;
-            }
-            the_game.dummy_enemy.allow_next_move = true;
-        }
-
-        // enemy shoot
-        if (the_game.enemy_shoot_tm >= the_game.enemy_shoot_interval && num_alive > 0) {
-            int alive_index = sx_rng_gen_rangei(&the_game.rng, 0, num_alive - 1);
-            create_bullet(the_game.enemies[alive_enemies[alive_index]].pos, BULLET_TYPE_ALIEN1);
-            the_game.enemy_shoot_tm = 0;
-            the_game.enemy_shoot_interval =
-                ENEMY_SHOOT_INTERVAL + (sx_rng_genf(&the_game.rng) * 2.0f - 1.0f) * 0.2f;
-        }
-        the_game.enemy_shoot_tm += dte / speed;
-
-        for (int i = 0; i < num_alive; i++) {
-            enemy_t* e = &the_game.enemies[alive_enemies[i]];
-            int cover_index = check_collision_with_covers(e);
-            if (cover_index != -1) {
-                cover_t* cover = &the_game.covers[cover_index];
-                cover->health -= 30;
-                cover->health = sx_max(cover->health, 0);
-                if (cover->health <= 0) {
-                    cover->dead = true;
-                }
-
-                the_game.enemy_explosion = true;
-                the_game.enemy_explosion_tm = 0;
-                the_game.enemy_explosion_pos = e->pos;
-
-                the_sound->play(the_sound->source_get(the_game.sounds[e->explode_sound]), 0, 1.0f,
-                                0, false);
-
-                e->dead = true;
-                break;
-            }
-        }
-    }
-
-    update_bullets(dt);
-
-    if (the_game.enemy_explosion) {
-        if (the_game.enemy_explosion_tm >= ENEMY_EXPLODE_TIME) {
-            the_game.enemy_explosion = false;
-        }
-        the_game.enemy_explosion_tm += dt;
-    }
-    update_explosions(dt);
-
-    if (the_game.player_died) {
-        if (the_game.player_explosion.wait_tm >= PLAYER_EXPLOSION_DURATION) {
-            the_game.player_died = false;
-            the_game.player_explosion.wait_tm = 0;
-            if (the_game.player_lives == 0) {
-                the_game.state = GAME_STATE_GAMEOVER;
-                rizz_coro_invoke(state_control, NULL);
-            }
-        }
-        the_game.player_explosion.wait_tm += dtp;
-    }
-
-    // saucer
-    saucer_t* saucer = &the_game.saucer;
-    if (saucer->dead) {
-        if (saucer->wait_tm >= saucer->wait_duration) {
-            spawn_saucer();
-            saucer->wait_tm = 0;
-        }
-        saucer->wait_tm += dt;
+        the_game.tick_accum = 0;
+        the_game.tick_alpha = 1.0f;
     } else {
-        saucer->pos.x += saucer->speed * dt;
-        if (saucer->pos.x < (-GAME_BOARD_WIDTH*0.5f - the_game.tile_size) ||
-            saucer->pos.x > (GAME_BOARD_WIDTH*0.5f + the_game.tile_size))
-        {
-            saucer->dead = true;
+        // drop the time we can't catch up with (hitches, debugger breaks), instead of spiraling
+        the_game.tick_accum =
+            sx_min(the_game.tick_accum + dt, tick_dt * (float)MAX_TICKS_PER_FRAME);
+
+        while (the_game.tick_accum >= tick_dt && tick_input(&input)) {
+            tick(&input, tick_dt, true);
+            the_game.tick_accum -= tick_dt;
         }
-    }
 
-     // heartbeat sound
-    the_game.heartbeat_tm += dte;
-    if (the_game.heartbeat_tm >= HEARTBEAT_INTERVAL) {
-        the_sound->play(the_sound->source_get(the_game.sounds[SOUND_HEARTBEAT]), 1, 1.0f, 0, false);
-        the_game.heartbeat_tm = 0;
+        the_game.tick_alpha = the_game.tick_accum / tick_dt;
     }
 
     rizz_profile_end(UPDATE);
 }
 
-static void render_info_screen(game_state_t state) 
+static void render_info_screen(game_state_t state)
 {
     rizz_api_gfx_draw* api = &the_gfx->staged;
     sg_pass_action pass_action = { .colors[0] = { SG_ACTION_CLEAR, { 0.0f, 0.0f, 0.0f, 1.0f } },
@@ -1174,7 +765,7 @@ static void render_info_screen(game_state_t state)
     if (state == GAME_STATE_GAMEOVER) {
         sx_strcpy(text, sizeof(text), "GAME OVER");
     } else {
-        sx_snprintf(text, sizeof(text), "STAGE  %d", the_game.stage + 1);
+        sx_snprintf(text, sizeof(text), "STAGE  %d", the_game.sim.stage + 1);
     }
 
     rizz_font_bounds bounds = the_2d->font.bounds(font, SX_VEC2_ZERO, text);
@@ -1183,7 +774,7 @@ static void render_info_screen(game_state_t state)
     the_2d->font.draw(font, text_pos, text);
 
     char highscore_text[32];
-    sx_snprintf(highscore_text, sizeof(highscore_text), "HIGH SCORE  %d", the_game.high_score);
+    sx_snprintf(highscore_text, sizeof(highscore_text), "HIGH SCORE  %d", the_game.sim.high_score);
     bounds = the_2d->font.bounds(font, SX_VEC2_ZERO, highscore_text);
     the_2d->font.draw(font,
                    sx_vec2f(w*0.5f - sx_rect_width(bounds.rect) * 0.5f, text_pos.y - 30.0f),
@@ -1193,6 +784,51 @@ static void render_info_screen(game_state_t state)
     api->end();    // RENDER_STAGE_GAME
 }
 
+// collision work of the ticks in the last frame, the stage times are only measured while open
+static void show_collision_debugger(bool* p_open)
+{
+    static const char* stage_names[SIM_COLLISION_STAGE_COUNT] = {
+        "Cover contacts", "Build", "Detect", "Resolve", "Bullets"
+    };
+
+    if (the_imgui->Begin("Collisions", p_open, 0)) {
+        const sim_collision_stats_t* stats = &the_game.frame_collision_stats;
+        the_imgui->Checkbox("Overlay", &the_game.show_collision_overlay);
+        the_imgui->Separator();
+
+        the_imgui->Text("candidates: %llu (dropped %llu), tests: %llu",
+                        (unsigned long long)stats->num_candidates,
+                        (unsigned long long)stats->num_candidates_dropped,
+                        (unsigned long long)stats->num_tests);
+        the_imgui->Text("bullets rejected by formation box: %llu/%llu",
+                        (unsigned long long)stats->num_enemy_queries_rejected,
+                        (unsigned long long)(stats->num_enemy_queries +
+                                             stats->num_enemy_queries_rejected));
+        the_imgui->Separator();
+
+        the_imgui->Text("hits: enemy %llu, saucer %llu, cover %llu, bullet %llu, player %llu",
+                        (unsigned long long)stats->hits[SIM_HIT_ENEMY],
+                        (unsigned long long)stats->hits[SIM_HIT_SAUCER],
+                        (unsigned long long)stats->hits[SIM_HIT_COVER],
+                        (unsigned long long)stats->num_bullet_hits,
+                        (unsigned long long)stats->hits[SIM_HIT_PLAYER]);
+        the_imgui->Text("enemy crashes: %llu", (unsigned long long)stats->hits[SIM_HIT_ENEMY_COVER]);
+        the_imgui->Separator();
+
+        const sim_state_t* sim = &the_game.sim;
+        the_imgui->Text("bullets: %d/%d, dropped %u", sim->num_bullets, sim->config.max_bullets,
+                        sim->bullet_pool.num_exhausted);
+        the_imgui->Text("explosions: %d/%d, dropped %u", sim->num_explosions,
+                        sim->config.max_explosions, sim->explosion_pool.num_exhausted);
+        the_imgui->Separator();
+
+        for (int i = 0; i < SIM_COLLISION_STAGE_COUNT; i++) {
+            the_imgui->Text("%s: %.1f us", stage_names[i], sx_tm_us(stats->stage_ticks[i]));
+        }
+    }
+    the_imgui->End();
+}
+
 static void show_devmenu(void)
 {
     bool* debug_mem = &the_game.show_debuggers[DEBUGGER_MEMORY];
@@ -1201,6 +837,7 @@ static void show_devmenu(void)
     bool* debug_sprites = &the_game.show_debuggers[DEBUGGER_SPRITES];
     bool* debug_sounds = &the_game.show_debuggers[DEBUGGER_SOUND];
     bool* debug_input = &the_game.show_debuggers[DEBUGGER_INPUT];
+    bool* debug_collisions = &the_game.show_debuggers[DEBUGGER_COLLISIONS];
     if (the_imgui->BeginMainMenuBar())
     {
         if (the_imgui->BeginMenu("Debug", true)) {
@@ -1227,9 +864,77 @@ static void show_devmenu(void)
             if (the_imgui->MenuItem_Bool("Input", NULL, *debug_input, true)) {
                 *debug_input = !(*debug_input);
             }
+
+            if (the_imgui->MenuItem_Bool("Collisions", NULL, *debug_collisions, true)) {
+                *debug_collisions = !(*debug_collisions);
+            }
             the_imgui->EndMenu();
 
         }
+
+        if (the_imgui->BeginMenu("Simulation", true)) {
+            // replays are bound to the tick rate they are recorded with
+            replay_mode_t mode = the_game.replay_mode;
+            if (mode == REPLAY_MODE_NONE) {
+                the_imgui->SliderInt("Tick rate", &the_game.tick_rate, 10, 240, "%d Hz");
+            }
+            the_imgui->Text("draw_bounds calls saved: %llu/frame",
+                            (unsigned long long)the_game.frame_bounds_lookups);
+            const arena_t* arena = &the_game.frame_arena;
+            the_imgui->Text("Frame arena: %.1f/%.1f KB, peak %.1f KB, failed %u",
+                            (double)the_game.last_frame_arena_size / 1024.0,
+                            (double)arena->size / 1024.0, (double)arena->peak / 1024.0,
+                            arena->num_failed);
+            the_imgui->Separator();
+
+            if (the_imgui->MenuItem_Bool("Record replay", NULL, mode == REPLAY_MODE_RECORD,
+                                         mode != REPLAY_MODE_PLAYBACK)) {
+                if (mode == REPLAY_MODE_RECORD) {
+                    stop_recording();
+                } else {
+                    start_recording();
+                }
+            }
+
+            if (the_imgui->MenuItem_Bool("Play replay", NULL, mode == REPLAY_MODE_PLAYBACK,
+                                         mode != REPLAY_MODE_RECORD)) {
+                if (mode == REPLAY_MODE_PLAYBACK) {
+                    stop_playback();
+                } else {
+                    start_playback();
+                }
+            }
+
+            if (the_imgui->MenuItem_Bool("Uncapped playback", NULL, the_game.replay_uncapped,
+                                         true)) {
+                the_game.replay_uncapped = !the_game.replay_uncapped;
+            }
+
+            if (the_imgui->MenuItem_Bool("Skip render in playback", NULL,
+                                         the_game.replay_skip_render, true)) {
+                the_game.replay_skip_render = !the_game.replay_skip_render;
+            }
+            the_imgui->Separator();
+
+            // stress test: formation and capacities are applied on restart
+            sim_config_t* config = &the_game.sim_config;
+            the_imgui->SliderInt("Columns", &config->enemies_per_row, 1, 1000, "%d");
+            the_imgui->SliderInt("Rows", &config->num_rows, 1, 500, "%d");
+            the_imgui->SliderInt("Bullets", &config->max_bullets, 1, 65536, "%d");
+            the_imgui->SliderInt("Explosions", &config->max_explosions, 1, 65536, "%d");
+            the_imgui->SliderInt("Covers", &config->num_covers, 0, 32, "%d");
+            bool grid = config->broadphase == SIM_BROADPHASE_GRID;
+            if (the_imgui->MenuItem_Bool("Grid broadphase", NULL, grid, true)) {
+                config->broadphase = grid ? SIM_BROADPHASE_FORMATION : SIM_BROADPHASE_GRID;
+            }
+            if (the_imgui->MenuItem_Bool("Restart", NULL, false, mode == REPLAY_MODE_NONE)) {
+                restart_sim(config, sx_rng_gen(&the_game.rng));
+            }
+            if (the_imgui->MenuItem_Bool("Reset to default", NULL, false, true)) {
+                *config = sim_default_config();
+            }
+            the_imgui->EndMenu();
+        }
      }
     the_imgui->EndMainMenuBar();
 
@@ -1251,18 +956,48 @@ static void show_devmenu(void)
     if (*debug_input) {
         the_input->show_debugger(debug_input);
     }
+    if (*debug_collisions) {
+        show_collision_debugger(debug_collisions);
+    }
 }
 
 static void render(void)
 {
+    const sim_state_t* sim = &the_game.sim;
+
     if (the_game.show_dev_menu) {
         show_devmenu();
-    }    
+    }
+
+    // the dev menu stays, so a smaller config can be restarted from it
+    if (the_game.sim_failed) {
+        return;
+    }
+
+    if (the_game.replay_mode == REPLAY_MODE_PLAYBACK && the_game.replay_skip_render) {
+        return;
+    }
+
+    if (sim->state != GAME_STATE_INGAME) {
+        render_info_screen(sim->state);
+        return;
+    }
+
+    // the biggest batch of the frame
+    int count = sx_max(sim->num_alive_enemies, sim->num_bullets);
+    count = sx_max(count, sim->num_explosions + 2);    // + enemy and player explosions
+    count = sx_max(count, sim->config.num_covers * COVER_MASK_HEIGHT * RENDER_MAX_HOLE_RUNS);
+    if (the_game.show_collision_overlay) {
+        // grid cells, hash cells, formation box and the boxes of enemies and bullets
+        count = sx_max(count, sim->enemy_grid.num_items + sim->world_hash.num_entries + 1 +
+                                  sim->num_alive_enemies + sim->num_bullets);
+    }
 
-    if (the_game.state != GAME_STATE_INGAME) {
-        render_info_screen(the_game.state);
+    render_buffers_t buffs;
+    if (!alloc_render_buffers(&buffs, count)) {
         return;
     }
+    const render_buffers_t* rb = &buffs;
 
     rizz_profile_begin(RENDER, 0);
 
@@ -1278,93 +1013,88 @@ static void render(void)
     the_camera->view_mat(&the_game.cam, &view);
     sx_mat4 vp = sx_mat4_mul(&proj, &view);
 
-    sx_mat3 enemy_mats[MAX_ENEMIES];
-    rizz_sprite enemy_sprites[MAX_ENEMIES];
-    int num_enemies = 0;
-    for (int i = 0; i < MAX_ENEMIES; i++) {
-        if (!the_game.enemies[i].dead) {
-            enemy_mats[num_enemies] = sx_mat3_translatev(the_game.enemies[i].pos);
-            enemy_sprites[num_enemies] = the_game.enemy_sprites[i];
-            num_enemies++;
-        }
-    }
+    render_interp_t interp = { .prev_enemy_pos = the_game.prev_enemy_pos,
+                               .alpha = the_game.tick_alpha,
+                               .tick_dt = 1.0f / (float)the_game.tick_rate,
+                               .snap_dist = sim->tile_size };
+
+    int num_enemies = render_batch_enemies(sim, &interp, rb->mats, rb->enemy_indices);
     if (num_enemies > 0) {
-        the_2d->sprite.draw_batch(enemy_sprites, num_enemies, &vp, enemy_mats, NULL);
+        for (int i = 0; i < num_enemies; i++) {
+            rb->sprites[i] = the_game.enemy_sprites[rb->enemy_indices[i]];
+        }
+        the_2d->sprite.draw_batch(rb->sprites, num_enemies, &vp, rb->mats, NULL);
     }
 
     // TODO: add another function for drawing by position
-    if (!the_game.player_died) {
-        sx_mat3 player_mat = sx_mat3_translatev(the_game.player.pos);
-        the_2d->sprite.draw(the_game.player.sprite, &vp, &player_mat, SX_COLOR_WHITE);
+    if (!sim->player_died) {
+        sx_mat3 player_mat = sx_mat3_translatev(
+            render_interp_pos(&interp, the_game.prev_player_pos, sim->player.pos));
+        the_2d->sprite.draw(the_game.player_sprite, &vp, &player_mat, SX_COLOR_WHITE);
     }
 
-    if (the_game.num_bullets > 0) {
-        sx_mat3 bullet_mats[MAX_BULLETS];
-        rizz_sprite bullet_sprites[MAX_BULLETS];
-        for (int i = 0; i < the_game.num_bullets; i++) {
-            bullet_mats[i] = sx_mat3_translatev(the_game.bullets[i].pos);
-            bullet_sprites[i] = the_game.bullets[i].sprite;
+    if (sim->num_bullets > 0) {
+        int num_bullets = render_batch_bullets(sim, &interp, rb->mats, rb->bullet_types);
+        for (int i = 0; i < num_bullets; i++) {
+            rb->sprites[i] = the_game.bullet_sprites[rb->bullet_types[i]];
         }
 
-        the_2d->sprite.draw_batch(bullet_sprites, the_game.num_bullets, &vp, bullet_mats, NULL);
+        the_2d->sprite.draw_batch(rb->sprites, num_bullets, &vp, rb->mats, NULL);
     }
 
     // explosions
     {
-        sx_mat3 explosion_mats[MAX_BULLETS + 2];
-        rizz_sprite explosion_sprites[MAX_BULLETS + 2];
-        for (int i = 0; i < the_game.num_explosions; i++) {
-            explosion_mats[i] = sx_mat3_translatev(the_game.explosions[i].pos);
-            explosion_sprites[i] = the_game.explosions[i].sprite;
-        }
-        int num_explosions = the_game.num_explosions;
-
-        if (the_game.enemy_explosion) {
-            explosion_mats[num_explosions] = sx_mat3_translatev(the_game.enemy_explosion_pos);
-            explosion_sprites[num_explosions] = the_game.enemy_explosion_sprite;
-            num_explosions++;
-        }
-
-        if (the_game.player_died) {
-            explosion_mats[num_explosions] = sx_mat3_translatev(the_game.player_explosion.pos);
-            explosion_sprites[num_explosions] = the_game.enemy_explosion_sprite;
-            num_explosions++;
+        int num_explosions = render_batch_explosions(sim, rb->mats, rb->explosion_types);
+        for (int i = 0; i < num_explosions; i++) {
+            rb->sprites[i] = explosion_sprite(rb->explosion_types[i]);
         }
 
         if (num_explosions > 0) {
-            the_2d->sprite.draw_batch(explosion_sprites, num_explosions, &vp, explosion_mats, NULL);
+            the_2d->sprite.draw_batch(rb->sprites, num_explosions, &vp, rb->mats, NULL);
         }
     }
 
     // covers
     {
-        sx_mat3 cover_mats[NUM_COVERS];
-        rizz_sprite cover_sprites[NUM_COVERS];
-        sx_color cover_colors[NUM_COVERS];
-        int count = 0;
-        for (int i = 0; i < NUM_COVERS; i++) {
-            if (!the_game.covers[i].dead) {
-                cover_mats[count] = sx_mat3_translatev(the_game.covers[i].pos);
-                cover_sprites[count] = the_game.cover_sprite;
-                float color_val = (float)the_game.covers[i].health / 100.0f;
-                cover_colors[count] = sx_color4f(1.0f - color_val, color_val, 0, 1.0f);
-                count++;
-            }
+        int count = render_batch_covers(sim, rb->mats, rb->colors);
+        for (int i = 0; i < count; i++) {
+            rb->sprites[i] = the_game.cover_sprite;
         }
         if (count > 0) {
-            the_2d->sprite.draw_batch(cover_sprites, count, &vp, cover_mats, cover_colors);
+            the_2d->sprite.draw_batch(rb->sprites, count, &vp, rb->mats, rb->colors);
+        }
+
+        render_cover_holes_t* holes = &the_game.cover_holes;
+        render_update_cover_holes(holes, sim);
+        int num_holes = render_batch_cover_holes(holes, sim, rb->mats);
+        for (int i = 0; i < num_holes; i++) {
+            rb->sprites[i] = the_game.cover_hole_sprite;
+        }
+        if (num_holes > 0) {
+            the_2d->sprite.draw_batch(rb->sprites, num_holes, &vp, rb->mats, NULL);
         }
     }
 
     // saucer
-    if (!the_game.saucer.dead) {
-        sx_mat3 mat = sx_mat3_translatev(the_game.saucer.pos);
-        the_2d->sprite.draw(the_game.saucer.sprite, &vp, &mat, SX_COLOR_WHITE);
+    if (!sim->saucer.dead) {
+        sx_mat3 mat = sx_mat3_translatev(
+            render_interp_pos(&interp, the_game.prev_saucer_pos, sim->saucer.pos));
+        the_2d->sprite.draw(the_game.saucer_sprite, &vp, &mat, SX_COLOR_WHITE);
+    }
+
+    if (the_game.show_collision_overlay) {
+        int count = render_batch_collision_overlay(sim, rb->mats, rb->colors, rb->count);
+        for (int i = 0; i < count; i++) {
+            rb->sprites[i] = the_game.overlay_sprite;
+        }
+        if (count > 0) {
+            the_2d->sprite.draw_batch(rb->sprites, count, &vp, rb->mats, rb->colors);
+        }
     }
 
     api->end_pass();
     api->end(); // RENDER_STAGE_GAME
-    
+
     api->begin(the_game.render_stages[RENDER_STAGE_UI]);
     {
         int w = the_app->width();
@@ -1375,10 +1105,10 @@ static void render(void)
         const rizz_font* font = the_2d->font.get(the_game.font);
         sx_mat4 vp = sx_mat4_ortho_offcenter(0, (float)h, (float)w, 0, -5.0f, 5.0f, 0, the_gfx->GL_family());
         the_2d->font.set_viewproj_mat(font, &vp);
-        the_2d->font.drawf(font, sx_vec2f(10.0f, 30.0f), "SCORE  %d", the_game.player_score);
+        the_2d->font.drawf(font, sx_vec2f(10.0f, 30.0f), "SCORE  %d", sim->player_score);
 
         char lives[32];
-        sx_snprintf(lives, sizeof(lives), "LIVES  %d", the_game.player_lives);
+        sx_snprintf(lives, sizeof(lives), "LIVES  %d", sim->player_lives);
         rizz_font_bounds bounds = the_2d->font.bounds(font, SX_VEC2_ZERO, lives);
         the_2d->font.drawf(font, sx_vec2f((float)(w - sx_rect_width(bounds.rect)*1.1f), 30.0f), lives);
         api->end_pass();
@@ -1392,6 +1122,7 @@ rizz_plugin_decl_main(space_invaders, plugin, e)
 {
     switch (e) {
     case RIZZ_PLUGIN_EVENT_STEP: {
+        reset_frame_arena();
         update((float)sx_tm_sec(the_core->delta_tick()));
         render();
         break;
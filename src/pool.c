@@ -0,0 +1,74 @@
+#include "pool.h"
+
+#include "sx/string.h"
+
+static inline uint32_t next_gen(uint32_t gen)
+{
+    return gen == (1u << POOL_GEN_BITS) - 1 ? 1 : gen + 1;
+}
+
+void pool_init(pool_t* pool, uint32_t* data, int capacity)
+{
+    sx_assert(capacity > 0 && capacity <= (1 << POOL_INDEX_BITS));
+
+    pool->slot_items = (int*)data;
+    pool->slot_gens = data + capacity;
+    pool->item_handles = data + capacity * 2;
+    pool->capacity = capacity;
+    pool->num_exhausted = 0;
+    for (int i = 0; i < capacity; i++) {
+        pool->slot_gens[i] = 1;
+    }
+    pool_clear(pool);
+}
+
+void pool_clear(pool_t* pool)
+{
+    // free slots are taken in order after a clear, same as a fresh pool
+    for (int i = 0; i < pool->capacity; i++) {
+        pool->slot_items[i] = i + 1 < pool->capacity ? i + 1 : -1;
+        pool->slot_gens[i] = next_gen(pool->slot_gens[i]);
+    }
+    pool->free_slot = 0;
+}
+
+void pool_copy(pool_t* dst, const pool_t* src)
+{
+    sx_assert(dst->capacity == src->capacity);
+    sx_memcpy(dst->slot_items, src->slot_items, sizeof(uint32_t) * pool_data_size(src->capacity));
+    dst->free_slot = src->free_slot;
+    dst->num_exhausted = src->num_exhausted;
+}
+
+pool_handle_t pool_add(pool_t* pool, int index)
+{
+    int slot = pool->free_slot;
+    if (slot == -1) {
+        ++pool->num_exhausted;
+        return POOL_INVALID_HANDLE;
+    }
+    sx_assert(index >= 0 && index < pool->capacity);
+
+    pool->free_slot = pool->slot_items[slot];
+    pool->slot_items[slot] = index;
+    pool_handle_t handle = (pool->slot_gens[slot] << POOL_INDEX_BITS) | (uint32_t)slot;
+    pool->item_handles[index] = handle;
+    return handle;
+}
+
+void pool_remove(pool_t* pool, int index, int count)
+{
+    sx_assert(index >= 0 && index < count && count <= pool->capacity);
+
+    int slot = pool_handle_slot(pool->item_handles[index]);
+    pool->slot_gens[slot] = next_gen(pool->slot_gens[slot]);
+    pool->slot_items[slot] = pool->free_slot;
+    pool->free_slot = slot;
+
+    int last = count - 1;
+    if (index < last) {
+        pool_handle_t moved = pool->item_handles[last];
+        pool->item_handles[index] = moved;
+        pool->slot_items[pool_handle_slot(moved)] = index;
+    }
+}
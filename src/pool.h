@@ -0,0 +1,70 @@
+#pragma once
+
+// Handle pool: generational handles for items that are kept packed in the caller's arrays. Items
+// are added at the end and swap-removed by the caller, so loops over them stay dense, and the pool
+// follows the moves to map each handle to the current index of it's item. A handle of a removed
+// item stays invalid until the generation of it's slot wraps around (POOL_GEN_BITS)
+// The capacity is fixed, adding to a full pool fails and is counted instead of replacing an item
+
+#include "sx/sx.h"
+
+#define POOL_INDEX_BITS 20
+#define POOL_GEN_BITS (32 - POOL_INDEX_BITS)
+#define POOL_INVALID_HANDLE 0u
+
+typedef uint32_t pool_handle_t;
+
+typedef struct pool_t {
+    int* slot_items;               // index of the item of each slot, or the next free slot
+    uint32_t* slot_gens;           // generation of each slot, never 0 so that no handle is 0
+    pool_handle_t* item_handles;   // handle of each item, in item order
+    int capacity;
+    int free_slot;                 // head of the free slots list, -1 when the pool is full
+    uint32_t num_exhausted;        // adds that failed because the pool was full
+} pool_t;
+
+// returns the number of uint32_t needed for `data` of `capacity` items
+static inline int pool_data_size(int capacity)
+{
+    return capacity * 3;
+}
+
+void pool_init(pool_t* pool, uint32_t* data, int capacity);
+
+// removes all items, their handles become invalid. `num_exhausted` is kept
+void pool_clear(pool_t* pool);
+
+// copies all slots and items of `src` to `dst`, they must have the same capacity
+void pool_copy(pool_t* dst, const pool_t* src);
+
+// registers the item that the caller puts at `index`, the end of it's array
+// returns POOL_INVALID_HANDLE if the pool is full
+pool_handle_t pool_add(pool_t* pool, int index);
+
+// the caller removes item `index` of `count` items by moving the last one in it's place
+void pool_remove(pool_t* pool, int index, int count);
+
+static inline int pool_handle_slot(pool_handle_t handle)
+{
+    return (int)(handle & ((1u << POOL_INDEX_BITS) - 1));
+}
+
+static inline uint32_t pool_handle_gen(pool_handle_t handle)
+{
+    return handle >> POOL_INDEX_BITS;
+}
+
+// current index of the item of `handle`, or -1 if the item was removed
+static inline int pool_index(const pool_t* pool, pool_handle_t handle)
+{
+    int slot = pool_handle_slot(handle);
+    if (slot >= pool->capacity || pool->slot_gens[slot] != pool_handle_gen(handle)) {
+        return -1;
+    }
+    return pool->slot_items[slot];
+}
+
+static inline pool_handle_t pool_handle(const pool_t* pool, int index)
+{
+    return pool->item_handles[index];
+}
@@ -0,0 +1,235 @@
+#include "render_batch.h"
+
+sx_vec2 render_interp_pos(const render_interp_t* interp, sx_vec2 prev, sx_vec2 cur)
+{
+    sx_vec2 d = sx_vec2_sub(cur, prev);
+    if (sx_abs(d.x) > interp->snap_dist || sx_abs(d.y) > interp->snap_dist) {
+        return cur;
+    }
+    return sx_vec2_add(prev, sx_vec2_mulf(d, interp->alpha));
+}
+
+int render_batch_enemies(const sim_state_t* sim, const render_interp_t* interp, sx_mat3* mats,
+                         int* indices)
+{
+    for (int k = 0; k < sim->num_alive_enemies; k++) {
+        int i = sim->alive_enemies[k];
+        mats[k] = sx_mat3_translatev(
+            render_interp_pos(interp, interp->prev_enemy_pos[i], sim->enemies.pos[i]));
+        indices[k] = i;
+    }
+    return sim->num_alive_enemies;
+}
+
+int render_batch_bullets(const sim_state_t* sim, const render_interp_t* interp, sx_mat3* mats,
+                         bullet_type_t* types)
+{
+    // bullets are swap-removed, so instead of keeping previous positions, step them back
+    // by the remaining fraction of the tick
+    for (int i = 0; i < sim->num_bullets; i++) {
+        const bullet_t* b = &sim->bullets[i];
+        float back = b->speed * interp->tick_dt * (1.0f - interp->alpha);
+        mats[i] = sx_mat3_translate(b->pos.x, b->pos.y - back);
+        types[i] = b->type;
+    }
+    return sim->num_bullets;
+}
+
+int render_batch_explosions(const sim_state_t* sim, sx_mat3* mats, explosion_type_t* types)
+{
+    for (int i = 0; i < sim->num_explosions; i++) {
+        mats[i] = sx_mat3_translatev(sim->explosions[i].pos);
+        types[i] = sim->explosions[i].type;
+    }
+    int count = sim->num_explosions;
+
+    if (sim->enemy_explosion) {
+        mats[count] = sx_mat3_translatev(sim->enemy_explosion_pos);
+        types[count] = EXPLOSION_TYPE_ENEMY;
+        count++;
+    }
+
+    if (sim->player_died) {
+        mats[count] = sx_mat3_translatev(sim->player_explosion.pos);
+        types[count] = EXPLOSION_TYPE_ENEMY;
+        count++;
+    }
+
+    return count;
+}
+
+int render_batch_covers(const sim_state_t* sim, sx_mat3* mats, sx_color* colors)
+{
+    int count = 0;
+    for (int i = 0; i < sim->config.num_covers; i++) {
+        if (!sim->covers[i].dead) {
+            mats[count] = sx_mat3_translatev(sim->covers[i].pos);
+            float color_val = (float)sim->covers[i].health / 100.0f;
+            colors[count] = sx_color4f(1.0f - color_val, color_val, 0, 1.0f);
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t render_cover_holes_data_size(int num_covers)
+{
+    int num_rows = num_covers * COVER_MASK_HEIGHT;
+    return (sizeof(uint64_t) + sizeof(uint8_t) * (RENDER_MAX_HOLE_RUNS * 2 + 1)) * num_rows;
+}
+
+void render_cover_holes_init(render_cover_holes_t* holes, void* data, int num_covers)
+{
+    int num_rows = num_covers * COVER_MASK_HEIGHT;
+    uint8_t* buff = data;
+    holes->rows = (uint64_t*)buff;
+    buff += sizeof(uint64_t) * num_rows;
+    holes->runs = buff;
+    buff += sizeof(uint8_t) * RENDER_MAX_HOLE_RUNS * 2 * num_rows;
+    holes->num_runs = buff;
+    holes->num_rows = num_rows;
+
+    // intact covers have no holes
+    for (int i = 0; i < num_rows; i++) {
+        holes->rows[i] = sim_cover_mask_row(i % COVER_MASK_HEIGHT);
+        holes->num_runs[i] = 0;
+    }
+}
+
+int render_update_cover_holes(render_cover_holes_t* holes, const sim_state_t* sim)
+{
+    sx_assert(holes->num_rows == sim->config.num_covers * COVER_MASK_HEIGHT);
+
+    int num_scanned = 0;
+    const uint64_t* rows = sim->cover_masks.ptr;
+    for (int i = 0; i < holes->num_rows; i++) {
+        if (rows[i] == holes->rows[i]) {
+            continue;
+        }
+
+        holes->rows[i] = rows[i];
+        uint64_t hole_bits = sim_cover_mask_row(i % COVER_MASK_HEIGHT) & ~rows[i];
+        uint8_t* runs = &holes->runs[i * RENDER_MAX_HOLE_RUNS * 2];
+        int num_runs = 0;
+        int x = 0;
+        while (hole_bits >> x) {
+            while (!((hole_bits >> x) & 1)) {
+                x++;
+            }
+            int start = x;
+            while ((hole_bits >> x) & 1) {
+                x++;
+            }
+            runs[num_runs * 2] = (uint8_t)start;
+            runs[num_runs * 2 + 1] = (uint8_t)(x - start);
+            num_runs++;
+        }
+        holes->num_runs[i] = (uint8_t)num_runs;
+        num_scanned++;
+    }
+    return num_scanned;
+}
+
+int render_batch_cover_holes(const render_cover_holes_t* holes, const sim_state_t* sim,
+                             sx_mat3* mats)
+{
+    float px = sx_rect_width(sim->bounds.cover) / (float)COVER_MASK_WIDTH;
+    float py = sx_rect_height(sim->bounds.cover) / (float)COVER_MASK_HEIGHT;
+
+    int count = 0;
+    for (int i = 0; i < sim->config.num_covers; i++) {
+        if (sim->covers[i].dead) {
+            continue;
+        }
+
+        sx_rect rc = sx_rect_move(sim->bounds.cover, sim->covers[i].pos);
+        for (int y = 0; y < COVER_MASK_HEIGHT; y++) {
+            int row = i * COVER_MASK_HEIGHT + y;
+            const uint8_t* runs = &holes->runs[row * RENDER_MAX_HOLE_RUNS * 2];
+            float cy = rc.ymax - py * ((float)y + 0.5f);
+            for (int r = 0; r < holes->num_runs[row]; r++) {
+                float w = px * (float)runs[r * 2 + 1];
+                float cx = rc.xmin + px * (float)runs[r * 2] + w * 0.5f;
+                mats[count++] = sx_mat3_SRT(w, py, 0, cx, cy);
+            }
+        }
+    }
+    return count;
+}
+
+typedef struct overlay_batch_t {
+    sx_mat3* mats;
+    sx_color* colors;
+    int count;
+    int max_items;
+} overlay_batch_t;
+
+static inline void add_overlay_box(overlay_batch_t* batch, sx_rect rc, sx_color color)
+{
+    if (batch->count < batch->max_items) {
+        sx_vec2 center = sx_vec2f((rc.xmin + rc.xmax) * 0.5f, (rc.ymin + rc.ymax) * 0.5f);
+        batch->mats[batch->count] =
+            sx_mat3_SRT(sx_rect_width(rc), sx_rect_height(rc), 0, center.x, center.y);
+        batch->colors[batch->count] = color;
+        batch->count++;
+    }
+}
+
+int render_batch_collision_overlay(const sim_state_t* sim, sx_mat3* mats, sx_color* colors,
+                                   int max_items)
+{
+    overlay_batch_t batch = { .mats = mats, .colors = colors, .max_items = max_items };
+
+    const grid_t* grid = &sim->enemy_grid;
+    if (grid->cell_start) {
+        for (int y = 0; y < grid->rows; y++) {
+            for (int x = 0; x < grid->cols; x++) {
+                int cell = grid_cell(grid, x, y);
+                if (grid->cell_start[cell + 1] > grid->cell_start[cell]) {
+                    sx_vec2 vmin = sx_vec2f(grid->origin.x + (float)x * grid->cell_size,
+                                            grid->origin.y + (float)y * grid->cell_size);
+                    add_overlay_box(&batch,
+                                    sx_rectf(vmin.x, vmin.y, vmin.x + grid->cell_size,
+                                             vmin.y + grid->cell_size),
+                                    sx_color4u(0, 0, 255, 48));
+                }
+            }
+        }
+    }
+
+    // cells of the hash are not stored, they are found again from the item boxes
+    const shash_t* hash = &sim->world_hash;
+    float cell_size = 1.0f / hash->inv_cell_size;
+    for (int i = 0; i < hash->num_items; i++) {
+        sx_rect rc = hash->items[i].box;
+        int xmin = (int)sx_floor(rc.xmin * hash->inv_cell_size);
+        int ymin = (int)sx_floor(rc.ymin * hash->inv_cell_size);
+        int xmax = (int)sx_floor(rc.xmax * hash->inv_cell_size);
+        int ymax = (int)sx_floor(rc.ymax * hash->inv_cell_size);
+        for (int y = ymin; y <= ymax; y++) {
+            for (int x = xmin; x <= xmax; x++) {
+                float cx = (float)x * cell_size;
+                float cy = (float)y * cell_size;
+                add_overlay_box(&batch, sx_rectf(cx, cy, cx + cell_size, cy + cell_size),
+                                sx_color4u(255, 0, 255, 32));
+            }
+        }
+    }
+
+    if (sim->formation_box.xmin <= sim->formation_box.xmax) {
+        add_overlay_box(&batch, sim->formation_box, sx_color4u(255, 255, 0, 32));
+    }
+    const sim_enemies_t* e = &sim->enemies;
+    for (int k = 0; k < sim->num_alive_enemies; k++) {
+        int i = sim->alive_enemies[k];
+        add_overlay_box(&batch, sx_rect_move(sim->bounds.enemies[e->kind[i]], e->pos[i]),
+                        sx_color4u(255, 0, 0, 64));
+    }
+    for (int i = 0; i < sim->num_bullets; i++) {
+        const bullet_t* b = &sim->bullets[i];
+        add_overlay_box(&batch, sx_rect_move(sim->bounds.bullets[b->type], b->pos),
+                        sx_color4u(0, 255, 0, 96));
+    }
+
+    return batch.count;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// Builds the per-instance arrays (transforms, colors) for batched sprite drawing from the simulation
+// state. Kept free of rizz APIs, so the cost can be measured in isolation (see bench.c)
+
+#include "sim.h"
+
+typedef struct render_interp_t {
+    const sx_vec2* prev_enemy_pos;    // enemy positions of the previous tick
+    float alpha;                      // interpolation factor between previous and current tick
+    float tick_dt;
+    float snap_dist;    // entities that moved more than this (spawn, reset) are not interpolated
+} render_interp_t;
+
+sx_vec2 render_interp_pos(const render_interp_t* interp, sx_vec2 prev, sx_vec2 cur);
+
+// returns number of items written to output arrays, `indices` receives the enemy index of each item
+int render_batch_enemies(const sim_state_t* sim, const render_interp_t* interp, sx_mat3* mats,
+                         int* indices);
+int render_batch_bullets(const sim_state_t* sim, const render_interp_t* interp, sx_mat3* mats,
+                         bullet_type_t* types);
+
+// output arrays must have room for `num_explosions + 2` items (enemy and player explosions)
+int render_batch_explosions(const sim_state_t* sim, sx_mat3* mats, explosion_type_t* types);
+int render_batch_covers(const sim_state_t* sim, sx_mat3* mats, sx_color* colors);
+
+// eroded pixels of the covers are drawn as black quads over the cover sprites, one for each run of
+// holes in a pixel row. the runs are cached and only the rows that changed since the last update
+// are scanned again, so a frame without hits costs a compare per row
+#define RENDER_MAX_HOLE_RUNS (COVER_MASK_WIDTH / 2)
+
+typedef struct render_cover_holes_t {
+    uint64_t* rows;       // mask rows the runs were built from
+    uint8_t* runs;        // start and length of each run, RENDER_MAX_HOLE_RUNS pairs per row
+    uint8_t* num_runs;    // runs in each row
+    int num_rows;
+} render_cover_holes_t;
+
+// returns the number of bytes needed for `data` of `num_covers` covers
+size_t render_cover_holes_data_size(int num_covers);
+void render_cover_holes_init(render_cover_holes_t* holes, void* data, int num_covers);
+
+// returns the number of rows that were scanned again
+int render_update_cover_holes(render_cover_holes_t* holes, const sim_state_t* sim);
+
+// output array must have room for `num_covers * COVER_MASK_HEIGHT * RENDER_MAX_HOLE_RUNS` items.
+// mats scale a sprite of 1x1 size with center origin to the holes
+int render_batch_cover_holes(const render_cover_holes_t* holes, const sim_state_t* sim,
+                             sx_mat3* mats);
+
+// debug overlay of the collision structures, as translucent quads of a 1x1 sprite with center
+// origin: the enemy grid cells that have items, the world hash cells of it's items, the formation
+// box, and the boxes of alive enemies and bullets. stops at `max_items`
+int render_batch_collision_overlay(const sim_state_t* sim, sx_mat3* mats, sx_color* colors,
+                                   int max_items);
@@ -0,0 +1,163 @@
+#include "replay.h"
+
+#include "sx/array.h"
+#include "sx/io.h"
+#include "sx/string.h"
+
+#define REPLAY_FOURCC sx_makefourcc('S', 'I', 'R', 'P')
+#define REPLAY_VERSION 3
+
+typedef struct replay_header_t {
+    uint32_t sign;
+    uint32_t version;
+    uint32_t seed;
+    uint32_t tick_rate;
+    uint32_t num_ticks;
+    uint32_t num_runs;
+    int32_t final_score;
+    uint32_t final_checksum;
+    int32_t enemies_per_row;
+    int32_t num_rows;
+    int32_t max_bullets;
+    int32_t max_explosions;
+    int32_t num_covers;
+} replay_header_t;
+
+uint16_t replay_pack_input(const sim_input_t* input)
+{
+    uint16_t bits = (input->left ? REPLAY_INPUT_LEFT : 0) | (input->right ? REPLAY_INPUT_RIGHT : 0) |
+                    (input->shoot ? REPLAY_INPUT_SHOOT : 0);
+    int8_t movex = (int8_t)sx_round(sx_clamp(input->movex, -1.0f, 1.0f) * 127.0f);
+    return (uint16_t)(bits | ((uint16_t)(uint8_t)movex << 8));
+}
+
+void replay_unpack_input(uint16_t packed, sim_input_t* input)
+{
+    input->left = (packed & REPLAY_INPUT_LEFT) != 0;
+    input->right = (packed & REPLAY_INPUT_RIGHT) != 0;
+    input->shoot = (packed & REPLAY_INPUT_SHOOT) != 0;
+    input->movex = (float)(int8_t)(uint8_t)(packed >> 8) / 127.0f;
+}
+
+void replay_begin(replay_t* replay, const sim_config_t* config, uint32_t seed, int tick_rate)
+{
+    sx_assert(tick_rate > 0);
+
+    sx_array_clear(replay->runs);
+    replay->config = *config;
+    replay->seed = seed;
+    replay->tick_rate = tick_rate;
+    replay->num_ticks = 0;
+    replay->final_score = 0;
+    replay->final_checksum = 0;
+    replay_rewind(replay);
+}
+
+void replay_release(replay_t* replay, const sx_alloc* alloc)
+{
+    sx_array_free(alloc, replay->runs);
+    sx_memset(replay, 0x0, sizeof(*replay));
+}
+
+void replay_record(replay_t* replay, const sx_alloc* alloc, sim_input_t* input)
+{
+    uint16_t packed = replay_pack_input(input);
+    replay_unpack_input(packed, input);
+
+    int num_runs = sx_array_count(replay->runs);
+    replay_run_t* last = num_runs > 0 ? &replay->runs[num_runs - 1] : NULL;
+    if (last && last->input == packed && last->count < UINT16_MAX) {
+        ++last->count;
+    } else {
+        sx_array_push(alloc, replay->runs, ((replay_run_t){ .input = packed, .count = 1 }));
+    }
+    ++replay->num_ticks;
+}
+
+bool replay_next(replay_t* replay, sim_input_t* input)
+{
+    if (replay->run_index >= sx_array_count(replay->runs)) {
+        return false;
+    }
+
+    const replay_run_t* run = &replay->runs[replay->run_index];
+    replay_unpack_input(run->input, input);
+    if (++replay->run_tick >= run->count) {
+        replay->run_tick = 0;
+        ++replay->run_index;
+    }
+    return true;
+}
+
+void replay_rewind(replay_t* replay)
+{
+    replay->run_index = 0;
+    replay->run_tick = 0;
+}
+
+bool replay_save(const replay_t* replay, const char* filepath)
+{
+    sx_file f;
+    if (!sx_file_open(&f, filepath, SX_FILE_WRITE)) {
+        return false;
+    }
+
+    replay_header_t header = { .sign = REPLAY_FOURCC,
+                               .version = REPLAY_VERSION,
+                               .seed = replay->seed,
+                               .tick_rate = (uint32_t)replay->tick_rate,
+                               .num_ticks = (uint32_t)replay->num_ticks,
+                               .num_runs = (uint32_t)sx_array_count(replay->runs),
+                               .final_score = replay->final_score,
+                               .final_checksum = replay->final_checksum,
+                               .enemies_per_row = replay->config.enemies_per_row,
+                               .num_rows = replay->config.num_rows,
+                               .max_bullets = replay->config.max_bullets,
+                               .max_explosions = replay->config.max_explosions,
+                               .num_covers = replay->config.num_covers };
+    sx_file_write(&f, &header, sizeof(header));
+    if (header.num_runs > 0) {
+        sx_file_write(&f, replay->runs, sizeof(replay_run_t) * header.num_runs);
+    }
+    sx_file_close(&f);
+    return true;
+}
+
+bool replay_load(replay_t* replay, const sx_alloc* alloc, const char* filepath)
+{
+    sx_file f;
+    if (!sx_file_open(&f, filepath, SX_FILE_READ)) {
+        return false;
+    }
+
+    replay_header_t header;
+    if (sx_file_read(&f, &header, sizeof(header)) != sizeof(header) ||
+        header.sign != REPLAY_FOURCC || header.version != REPLAY_VERSION || header.tick_rate == 0 ||
+        header.enemies_per_row <= 0 || header.num_rows <= 0 || header.max_bullets <= 0 ||
+        header.max_explosions <= 0 || header.num_covers < 0) {
+        sx_file_close(&f);
+        return false;
+    }
+
+    sim_config_t config = { .enemies_per_row = header.enemies_per_row,
+                            .num_rows = header.num_rows,
+                            .max_bullets = header.max_bullets,
+                            .max_explosions = header.max_explosions,
+                            .num_covers = header.num_covers };
+    replay_begin(replay, &config, header.seed, (int)header.tick_rate);
+    replay->num_ticks = (int)header.num_ticks;
+    replay->final_score = header.final_score;
+    replay->final_checksum = header.final_checksum;
+    if (header.num_runs > 0) {
+        replay_run_t* runs = sx_array_add(alloc, replay->runs, (int)header.num_runs);
+        int64_t size = sizeof(replay_run_t) * header.num_runs;
+        if (sx_file_read(&f, runs, size) != size) {
+            sx_array_clear(replay->runs);
+            sx_file_close(&f);
+            return false;
+        }
+    }
+
+    sx_file_close(&f);
+    return true;
+}
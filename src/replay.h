@@ -0,0 +1,51 @@
+#pragma once
+
+// Input recording and playback for the game simulation
+// A replay is the config, rng seed and tick rate of the simulation, plus per-tick input, run-length
+// encoded
+// Because the simulation is deterministic with fixed ticks, this is enough to reproduce a whole game
+
+#include "sx/allocator.h"
+
+#include "sim.h"
+
+#define REPLAY_INPUT_LEFT 0x1
+#define REPLAY_INPUT_RIGHT 0x2
+#define REPLAY_INPUT_SHOOT 0x4
+
+// consecutive ticks with the same input
+// input: button bits in the lower byte, quantized analog movex (int8) in the higher byte
+typedef struct replay_run_t {
+    uint16_t input;
+    uint16_t count;
+} replay_run_t;
+
+typedef struct replay_t {
+    sim_config_t config;
+    uint32_t seed;
+    int tick_rate;
+    int num_ticks;
+    int final_score;          // score at the end of recording
+    uint32_t final_checksum;  // sim_checksum at the end of recording, used to verify playback
+    replay_run_t* runs;    // sx_array
+
+    // playback cursor
+    int run_index;
+    int run_tick;
+} replay_t;
+
+uint16_t replay_pack_input(const sim_input_t* input);
+void replay_unpack_input(uint16_t packed, sim_input_t* input);
+
+void replay_begin(replay_t* replay, const sim_config_t* config, uint32_t seed, int tick_rate);
+void replay_release(replay_t* replay, const sx_alloc* alloc);
+
+// quantizes `input` in place, so the recording session simulates exactly what will be played back
+void replay_record(replay_t* replay, const sx_alloc* alloc, sim_input_t* input);
+
+// fetches input for the next tick, returns false at the end of the replay
+bool replay_next(replay_t* replay, sim_input_t* input);
+void replay_rewind(replay_t* replay);
+
+bool replay_save(const replay_t* replay, const char* filepath);
+bool replay_load(replay_t* replay, const sx_alloc* alloc, const char* filepath);
@@ -0,0 +1,158 @@
+#include "shash.h"
+
+#include "sx/string.h"
+
+// far away coords are clamped, they only share cells with each other
+#define SHASH_MAX_COORD 1000000
+
+// queries are per bullet, so this avoids a floor call with a truncation fixed for negative coords
+static inline int shash_coord(float v, float inv_cell_size)
+{
+    float c = sx_clamp(v * inv_cell_size, (float)-SHASH_MAX_COORD, (float)SHASH_MAX_COORD);
+    int i = (int)c;
+    return (float)i > c ? i - 1 : i;
+}
+
+// range of cells overlapped by `box`, inclusive
+typedef struct shash_range_t {
+    int xmin;
+    int ymin;
+    int xmax;
+    int ymax;
+} shash_range_t;
+
+static inline shash_range_t shash_cells(float inv_cell_size, sx_rect box)
+{
+    return (shash_range_t){ .xmin = shash_coord(box.xmin, inv_cell_size),
+                            .ymin = shash_coord(box.ymin, inv_cell_size),
+                            .xmax = shash_coord(box.xmax, inv_cell_size),
+                            .ymax = shash_coord(box.ymax, inv_cell_size) };
+}
+
+static inline int shash_bucket(const shash_t* hash, int x, int y)
+{
+    uint32_t h = ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u);
+    return (int)(h & (uint32_t)(hash->num_buckets - 1));
+}
+
+static int shash_num_buckets(int max_items)
+{
+    // about twice as many buckets as entries keeps the unrelated cells in a bucket few
+    int num_buckets = 1;
+    while (num_buckets < shash_max_entries(max_items) * 2) {
+        num_buckets <<= 1;
+    }
+    return num_buckets;
+}
+
+int shash_bucket_start_size(int max_items)
+{
+    return shash_num_buckets(max_items) + 1;
+}
+
+void shash_init(shash_t* hash, float cell_size, int max_items, shash_item_t* items, int* entries,
+                int* bucket_start)
+{
+    sx_assert(cell_size > 0);
+
+    hash->inv_cell_size = 1.0f / cell_size;
+    hash->num_buckets = shash_num_buckets(max_items);
+    hash->bucket_start = bucket_start;
+    hash->entries = entries;
+    hash->items = items;
+    hash->max_items = max_items;
+    hash->max_entries = shash_max_entries(max_items);
+    shash_clear(hash);
+    shash_build(hash);
+}
+
+void shash_clear(shash_t* hash)
+{
+    hash->num_items = 0;
+    hash->num_entries = 0;
+}
+
+void shash_add(shash_t* hash, sx_rect box, uint32_t layer, int id)
+{
+    sx_assert(hash->num_items < hash->max_items);
+    hash->items[hash->num_items++] = (shash_item_t){ .box = box, .layer = layer, .id = id };
+}
+
+void shash_build(shash_t* hash)
+{
+    const float inv_cell_size = hash->inv_cell_size;
+    int* bucket_start = hash->bucket_start;
+
+    // count entries in each bucket, then turn the counts into end offsets
+    sx_memset(bucket_start, 0x0, sizeof(int) * (hash->num_buckets + 1));
+    int num_entries = 0;
+    for (int i = 0; i < hash->num_items; i++) {
+        shash_range_t r = shash_cells(inv_cell_size, hash->items[i].box);
+        for (int y = r.ymin; y <= r.ymax; y++) {
+            for (int x = r.xmin; x <= r.xmax; x++) {
+                ++bucket_start[shash_bucket(hash, x, y)];
+                ++num_entries;
+            }
+        }
+    }
+    sx_assert(num_entries <= hash->max_entries && "items must not be bigger than cells");
+
+    int offset = 0;
+    for (int b = 0; b < hash->num_buckets; b++) {
+        offset += bucket_start[b];
+        bucket_start[b] = offset;
+    }
+    bucket_start[hash->num_buckets] = num_entries;
+
+    // fill backwards, decrementing end offsets to start offsets, keeps the add order within buckets
+    for (int i = hash->num_items - 1; i >= 0; i--) {
+        shash_range_t r = shash_cells(inv_cell_size, hash->items[i].box);
+        for (int y = r.ymax; y >= r.ymin; y--) {
+            for (int x = r.xmax; x >= r.xmin; x--) {
+                hash->entries[--bucket_start[shash_bucket(hash, x, y)]] = i;
+            }
+        }
+    }
+
+    hash->num_entries = num_entries;
+}
+
+int shash_query(const shash_t* hash, sx_rect rect, uint32_t mask, int* items, int max_items)
+{
+    const float inv_cell_size = hash->inv_cell_size;
+    shash_range_t r = shash_cells(inv_cell_size, rect);
+
+    int count = 0;
+    for (int y = r.ymin; y <= r.ymax; y++) {
+        for (int x = r.xmin; x <= r.xmax; x++) {
+            int b = shash_bucket(hash, x, y);
+            for (int e = hash->bucket_start[b], end = hash->bucket_start[b + 1]; e < end; e++) {
+                int index = hash->entries[e];
+                const shash_item_t* item = &hash->items[index];
+                if (!(item->layer & mask)) {
+                    continue;
+                }
+
+                sx_rect box = item->box;
+                if (box.xmax < rect.xmin || rect.xmax < box.xmin || box.ymax < rect.ymin ||
+                    rect.ymax < box.ymin) {
+                    continue;
+                }
+
+                // items with entries in several of the visited cells are only reported from the
+                // cell of the min corner of the overlap, this also skips other cells in the bucket
+                float ox = sx_max(box.xmin, rect.xmin);
+                float oy = sx_max(box.ymin, rect.ymin);
+                if (shash_coord(ox, inv_cell_size) != x || shash_coord(oy, inv_cell_size) != y) {
+                    continue;
+                }
+
+                if (count < max_items) {
+                    items[count] = index;
+                }
+                ++count;
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// Spatial hash broadphase: items are boxes tagged with a layer bit, with an entry in each cell they
+// overlap. Cells are hashed into a fixed number of buckets, so the area is unbounded and the memory
+// only depends on the item count. The entries are bucketed with a counting sort, so the whole hash
+// is rebuilt in linear time. Queries take a mask of the layers they collide with, and report each
+// overlapping item once
+
+#include "sx/math.h"
+
+typedef struct shash_item_t {
+    sx_rect box;
+    uint32_t layer;    // single bit
+    int id;            // user index, usually the index of the entity in it's own array
+} shash_item_t;
+
+typedef struct shash_t {
+    float inv_cell_size;
+    int num_buckets;      // power of two
+    int* bucket_start;    // entries of bucket `b` are entries[bucket_start[b]..bucket_start[b+1]]
+    int* entries;         // item indices sorted by bucket
+    shash_item_t* items;
+    int num_items;
+    int max_items;
+    int num_entries;
+    int max_entries;
+} shash_t;
+
+// items bigger than a cell have an entry for every cell they overlap, so with cells at least as big
+// as the items, there are at most 4 entries for an item
+static inline int shash_max_entries(int max_items)
+{
+    return max_items * 4;
+}
+
+// returns the number of ints needed for `bucket_start`
+int shash_bucket_start_size(int max_items);
+
+// items: array of `max_items`, entries: array of `shash_max_entries` ints
+void shash_init(shash_t* hash, float cell_size, int max_items, shash_item_t* items, int* entries,
+                int* bucket_start);
+
+// removes all items, add them again and build the hash for the next queries
+void shash_clear(shash_t* hash);
+void shash_add(shash_t* hash, sx_rect box, uint32_t layer, int id);
+void shash_build(shash_t* hash);
+
+// writes the item indices of up to `max_items` items that are in one of the `mask` layers and
+// overlap `rect` (inclusive, same as c2AABBtoAABB), returns the number of items found, which is
+// more than `max_items` when some of them were not written
+int shash_query(const shash_t* hash, sx_rect rect, uint32_t mask, int* items, int max_items);
@@ -0,0 +1,1739 @@
+#include "sim.h"
+
+#include "sx/string.h"
+#include "sx/timer.h"
+
+#define CUTE_C2_IMPLEMENTATION
+SX_PRAGMA_DIAGNOSTIC_PUSH()
+SX_PRAGMA_DIAGNOSTIC_IGNORED_CLANG("-Wswitch")
+SX_PRAGMA_DIAGNOSTIC_IGNORED_CLANG("-Wunused-function")
+#include "cute_c2.h"
+SX_PRAGMA_DIAGNOSTIC_POP()
+
+// calculates the same bounds as 2dtools sprite.draw_bounds for a sprite in game-sprites atlas
+// img_size/img_rect: image size and the non-transparent rect of the image in pixels
+// size: sprite size, if one of the components is zero, it will be calculated by image aspect ratio
+static sx_rect sprite_bounds(sx_vec2 img_size, sx_rect img_rect, sx_vec2 size, sx_vec2 origin)
+{
+    if (size.x <= 0) {
+        size.x = size.y * img_size.x / img_size.y;
+    } else if (size.y <= 0) {
+        size.y = size.x * img_size.y / img_size.x;
+    }
+
+    // image coords are top-down
+    return sx_rectf((img_rect.xmin / img_size.x - 0.5f - origin.x) * size.x,
+                    ((1.0f - img_rect.ymax / img_size.y) - 0.5f - origin.y) * size.y,
+                    (img_rect.xmax / img_size.x - 0.5f - origin.x) * size.x,
+                    ((1.0f - img_rect.ymin / img_size.y) - 0.5f - origin.y) * size.y);
+}
+
+static void init_bounds(sim_bounds_t* bounds, float tile_size, float cover_size)
+{
+    // clang-format off
+    bounds->enemies[ENEMY_KIND_3] = sprite_bounds(sx_vec2f(20, 14), sx_rectf(2, 0, 18, 14),
+                                                  sx_vec2f(tile_size * 0.8f, 0), SX_VEC2_ZERO);
+    bounds->enemies[ENEMY_KIND_1] = sprite_bounds(sx_vec2f(20, 14), sx_rectf(0, 0, 20, 14),
+                                                  sx_vec2f(tile_size * 0.8f, 0), SX_VEC2_ZERO);
+    bounds->enemies[ENEMY_KIND_2] = sprite_bounds(sx_vec2f(20, 13), sx_rectf(0, 0, 20, 13),
+                                                  sx_vec2f(tile_size * 0.8f, 0), SX_VEC2_ZERO);
+    bounds->bullets[BULLET_TYPE_PLAYER] = sprite_bounds(sx_vec2f(4, 18), sx_rectf(0, 0, 4, 18),
+                                                        sx_vec2f(0, tile_size * 0.5f), sx_vec2f(0, -0.5f));
+    bounds->bullets[BULLET_TYPE_ALIEN1] = sprite_bounds(sx_vec2f(6, 12), sx_rectf(0, 0, 6, 12),
+                                                        sx_vec2f(0, tile_size * 0.5f), sx_vec2f(0, 0.5f));
+    bounds->player = sprite_bounds(sx_vec2f(26, 16), sx_rectf(0, 0, 26, 16),
+                                   sx_vec2f(tile_size, 0), SX_VEC2_ZERO);
+    bounds->cover = sprite_bounds(sx_vec2f(44, 32), sx_rectf(0, 0, 44, 32),
+                                  sx_vec2f(cover_size, 0), sx_vec2f(-0.5f, -0.5f));
+    bounds->saucer = sprite_bounds(sx_vec2f(48, 21), sx_rectf(0, 0, 48, 21),
+                                   sx_vec2f(tile_size, 0), SX_VEC2_ZERO);
+    // clang-format on
+
+    bounds->enemy_max = SX_RECT_EMPTY;
+    for (int i = 0; i < ENEMY_KIND_COUNT; i++) {
+        sx_rect_add_point(&bounds->enemy_max, bounds->enemies[i].vmin);
+        sx_rect_add_point(&bounds->enemy_max, bounds->enemies[i].vmax);
+    }
+}
+
+// sim bounds are Y-UP, so min/max map directly to c2AABB
+static inline c2AABB rect_to_aabb(sx_rect rc)
+{
+    return (c2AABB){ { rc.xmin, rc.ymin }, { rc.xmax, rc.ymax } };
+}
+
+// alpha of cover.png in game-sprites atlas, bit 0 is the left column and row 0 is the top
+// clang-format off
+static const uint64_t k_cover_mask[COVER_MASK_HEIGHT] = {
+    0x0000000ffffffc00ull, 0x0000000ffffffc00ull,
+    0x0000003fffffffc0ull, 0x0000003fffffffc0ull,
+    0x000000fffffffff0ull, 0x000000fffffffff0ull,
+    0x000003fffffffffcull, 0x000003fffffffffcull,
+    0x00000fffffffffffull, 0x00000fffffffffffull,
+    0x00000fffffffffffull, 0x00000fffffffffffull,
+    0x00000fffffffffffull, 0x00000fffffffffffull,
+    0x00000fffffffffffull, 0x00000fffffffffffull,
+    0x00000fffffffffffull, 0x00000fffffffffffull,
+    0x00000fffffffffffull, 0x00000fffffffffffull,
+    0x00000fffffffffffull, 0x00000fffffffffffull,
+    0x00000fffffffffffull, 0x00000fffffffffffull,
+    0x00000ffff0003fffull, 0x00000ffff0003fffull,
+    0x00000fffc0000fffull, 0x00000fffc0000fffull,
+    0x00000fff000003ffull, 0x00000fff000003ffull,
+    0x00000fff000003ffull, 0x00000fff000003ffull,
+};
+// clang-format on
+#define COVER_MASK_PIXELS 1172    // set bits of k_cover_mask
+
+uint64_t sim_cover_mask_row(int row)
+{
+    sx_assert(row >= 0 && row < COVER_MASK_HEIGHT);
+    return k_cover_mask[row];
+}
+
+static inline int popcount64(uint64_t v)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(v);
+#else
+    int count = 0;
+    for (; v; v &= v - 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+static inline uint64_t* cover_mask_rows(const sim_state_t* sim, int index)
+{
+    return &sim->cover_masks.ptr[index * COVER_MASK_HEIGHT];
+}
+
+// bits [xmin, xmax] of a mask row
+static inline uint64_t cover_mask_cols(int xmin, int xmax)
+{
+    return (~0ull >> (63 - xmax)) & (~0ull << xmin);
+}
+
+// inclusive range of cover pixels, ymin is the top row
+typedef struct cover_pixels_t {
+    int xmin;
+    int ymin;
+    int xmax;
+    int ymax;
+} cover_pixels_t;
+
+static inline int cover_pixel_coord(float v, int count)
+{
+    return (int)sx_floor(sx_clamp(v, -1.0f, (float)count));
+}
+
+// pixels of cover `index` under `rect`, returns false if the rect is outside of the cover
+static bool cover_pixel_range(const sim_state_t* sim, int index, sx_rect rect,
+                              cover_pixels_t* range)
+{
+    sx_rect cover_rect = sx_rect_move(sim->bounds.cover, sim->covers[index].pos);
+    float px = (float)COVER_MASK_WIDTH / sx_rect_width(cover_rect);
+    float py = (float)COVER_MASK_HEIGHT / sx_rect_height(cover_rect);
+
+    int xmin = cover_pixel_coord((rect.xmin - cover_rect.xmin) * px, COVER_MASK_WIDTH);
+    int xmax = cover_pixel_coord((rect.xmax - cover_rect.xmin) * px, COVER_MASK_WIDTH);
+    int ymin = cover_pixel_coord((cover_rect.ymax - rect.ymax) * py, COVER_MASK_HEIGHT);
+    int ymax = cover_pixel_coord((cover_rect.ymax - rect.ymin) * py, COVER_MASK_HEIGHT);
+    range->xmin = sx_max(xmin, 0);
+    range->xmax = sx_min(xmax, COVER_MASK_WIDTH - 1);
+    range->ymin = sx_max(ymin, 0);
+    range->ymax = sx_min(ymax, COVER_MASK_HEIGHT - 1);
+    return range->xmin <= range->xmax && range->ymin <= range->ymax;
+}
+
+// world rect of pixel row `row` of cover `index`
+static inline sx_rect cover_row_rect(const sim_state_t* sim, int index, int row)
+{
+    sx_rect cover_rect = sx_rect_move(sim->bounds.cover, sim->covers[index].pos);
+    float row_height = sx_rect_height(cover_rect) / (float)COVER_MASK_HEIGHT;
+    return sx_rectf(cover_rect.xmin, cover_rect.ymax - row_height * (float)(row + 1),
+                    cover_rect.xmax, cover_rect.ymax - row_height * (float)row);
+}
+
+static bool cover_pixels_hit(const sim_state_t* sim, int index, sx_rect rect)
+{
+    cover_pixels_t range;
+    if (!cover_pixel_range(sim, index, rect, &range)) {
+        return false;
+    }
+
+    const uint64_t* rows = cover_mask_rows(sim, index);
+    uint64_t cols = cover_mask_cols(range.xmin, range.xmax);
+    for (int y = range.ymin; y <= range.ymax; y++) {
+        if (rows[y] & cols) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void update_cover_health(sim_state_t* sim, int index)
+{
+    const uint64_t* rows = cover_mask_rows(sim, index);
+    int num_pixels = 0;
+    for (int y = 0; y < COVER_MASK_HEIGHT; y++) {
+        num_pixels += popcount64(rows[y]);
+    }
+
+    cover_t* cover = &sim->covers[index];
+    cover->health = num_pixels * 100 / COVER_MASK_PIXELS;
+    if (num_pixels == 0) {
+        cover->dead = true;
+        aabb_soa_clear(&sim->cover_boxes, index);
+    }
+}
+
+// clears a disc of pixels around pixel (x, y)
+static void erode_cover(sim_state_t* sim, int index, int x, int y, int radius)
+{
+    uint64_t* rows = cover_mask_rows(sim, index);
+    for (int dy = -radius; dy <= radius; dy++) {
+        int row = y + dy;
+        if (row < 0 || row >= COVER_MASK_HEIGHT) {
+            continue;
+        }
+
+        int half = (int)sx_sqrt((float)(radius * radius - dy * dy));
+        int xmin = sx_max(x - half, 0);
+        int xmax = sx_min(x + half, COVER_MASK_WIDTH - 1);
+        if (xmin <= xmax) {
+            rows[row] &= ~cover_mask_cols(xmin, xmax);
+        }
+    }
+    update_cover_health(sim, index);
+}
+
+// clears the pixels under `rect`
+static void erode_cover_rect(sim_state_t* sim, int index, sx_rect rect)
+{
+    cover_pixels_t range;
+    if (cover_pixel_range(sim, index, rect, &range)) {
+        uint64_t* rows = cover_mask_rows(sim, index);
+        uint64_t cols = cover_mask_cols(range.xmin, range.xmax);
+        for (int y = range.ymin; y <= range.ymax; y++) {
+            rows[y] &= ~cols;
+        }
+        update_cover_health(sim, index);
+    }
+}
+
+static void push_event(sim_state_t* sim, sim_event_t e)
+{
+    if (sim->num_events < SIM_MAX_EVENTS) {
+        sim->events[sim->num_events++] = e;
+    } else {
+        ++sim->num_events_dropped;
+    }
+}
+
+static void play_sound(sim_state_t* sim, sound_type_t sound, int bus)
+{
+    push_event(sim, (sim_event_t){ .type = SIM_EVENT_SOUND, .sound = sound, .bus = bus });
+}
+
+static void set_state(sim_state_t* sim, game_state_t state)
+{
+    // already waiting for the transition to finish
+    if (sim->state != GAME_STATE_INGAME) {
+        return;
+    }
+
+    sim->state = state;
+    sim->state_tm = 0;
+
+    if (sim->player_score > sim->high_score) {
+        sim->high_score = sim->player_score;
+        push_event(sim, (sim_event_t){ .type = SIM_EVENT_HIGH_SCORE });
+    }
+
+    if (state == GAME_STATE_GAMEOVER) {
+        sim->player_score = 0;
+    }
+
+    push_event(sim, (sim_event_t){ .type = SIM_EVENT_STATE, .state = state });
+}
+
+// the step of the move in progress, one tile in the direction of the formation
+static sx_vec2 formation_move(const sim_state_t* sim)
+{
+    switch (sim->formation.dir) {
+    case ENEMY_MOVEMENT_DOWN:
+        return sx_vec2f(0, -sim->tile_size);
+    case ENEMY_MOVEMENT_LEFT:
+        return sx_vec2f(-sim->tile_size, 0);
+    default:
+        return sx_vec2f(sim->tile_size, 0);
+    }
+}
+
+// enemies are at their place in the layout plus the formation offset, and the part of the move in
+// progress they have done (see sim_formation_t)
+static void update_enemy_positions(sim_state_t* sim)
+{
+    const sim_formation_t* f = &sim->formation;
+    const int per_row = sim->config.enemies_per_row;
+    const float tile_size = sim->tile_size;
+    const float num_enemies = (float)sim->num_enemies;
+    sx_vec2 origin = sx_vec2_add(sim->formation_pos, f->offset);
+    sx_vec2 move = formation_move(sim);
+    sx_vec2* pos = sim->enemies.pos;
+    for (int k = 0; k < sim->num_alive_enemies; k++) {
+        int i = sim->alive_enemies[k];
+        float t = sx_clamp(f->move_tm - ENEMY_WAIT_DURATION - (float)i / num_enemies, 0, 1.0f);
+        pos[i] = sx_vec2f(origin.x + (float)(i % per_row) * tile_size + move.x * t,
+                          origin.y - (float)(i / per_row) * tile_size + move.y * t);
+    }
+}
+
+// the formation box is grown while the boxes are written, so it's tight to the enemies alive after
+// the moves of the step. kills after this only make it conservative until the next step
+// boxes of dead enemies are cleared when they are killed, so only the alive ones are visited
+static void update_enemy_boxes(sim_state_t* sim)
+{
+    const sim_enemies_t* e = &sim->enemies;
+    sx_rect formation_box = SX_RECT_EMPTY;
+    for (int k = 0; k < sim->num_alive_enemies; k++) {
+        int i = sim->alive_enemies[k];
+        sx_rect box = sx_rect_move(sim->bounds.enemies[e->kind[i]], e->pos[i]);
+        aabb_soa_set(&sim->enemy_boxes, i, box);
+        sx_rect_add_point(&formation_box, box.vmin);
+        sx_rect_add_point(&formation_box, box.vmax);
+    }
+    sim->formation_box = formation_box;
+}
+
+// first alive enemy at or above `index` in it's column, or -1. rows are stored top to bottom
+static int find_column_bottom(const sim_state_t* sim, int index)
+{
+    for (; index >= 0; index -= sim->config.enemies_per_row) {
+        if (sim_enemy_alive(sim, index)) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+static void reset_column_bottoms(sim_state_t* sim)
+{
+    const int per_row = sim->config.enemies_per_row;
+    const int last_row = (sim->config.num_rows - 1) * per_row;
+    for (int col = 0; col < per_row; col++) {
+        sim->column_bottom[col] = find_column_bottom(sim, last_row + col);
+    }
+}
+
+// only the enemies above can take the place of a killed bottom one, so the walks of a column add
+// up to it's row count over a wave
+static void kill_enemy(sim_state_t* sim, int index)
+{
+    sx_bitarray_unset(&sim->enemies.alive, index);
+    aabb_soa_clear(&sim->enemy_boxes, index);
+
+    // the list stays sorted, enemy shots pick from it by position
+    int* alive_enemies = sim->alive_enemies;
+    int num_alive = sim->num_alive_enemies;
+    int lo = 0, hi = num_alive;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (alive_enemies[mid] < index) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    int k = lo;
+    sx_assert(k < num_alive && alive_enemies[k] == index);
+    sx_memmove(alive_enemies + k, alive_enemies + k + 1, sizeof(int) * (num_alive - k - 1));
+    sim->num_alive_enemies = num_alive - 1;
+
+    const int per_row = sim->config.enemies_per_row;
+    int col = index % per_row;
+    if (sim->column_bottom[col] == index) {
+        sim->column_bottom[col] = find_column_bottom(sim, index - per_row);
+    }
+}
+
+void sim_refresh(sim_state_t* sim)
+{
+    float tile_size = sim->tile_size;
+    float half_width = GAME_BOARD_WIDTH * 0.5f;
+    float y = GAME_BOARD_HEIGHT * 0.5f - tile_size - tile_size * 0.5f * ((float)sim->stage);
+    sim->formation_pos = sx_vec2f(-half_width + 2.5f * tile_size, y - tile_size);
+    sim->formation = (sim_formation_t){ .dir = ENEMY_MOVEMENT_RIGHT };
+
+    const int num_enemies = sim->num_enemies;
+    for (int i = 0; i < num_enemies; i++) {
+        sx_bitarray_set(&sim->enemies.alive, i);
+        sim->alive_enemies[i] = i;
+    }
+    sim->num_alive_enemies = num_enemies;
+
+    update_enemy_positions(sim);
+    update_enemy_boxes(sim);
+    reset_column_bottoms(sim);
+
+    for (int i = 0; i < sim->config.num_covers; i++) {
+        sim->covers[i].dead = false;
+        sim->covers[i].health = 100;
+        sx_memcpy(cover_mask_rows(sim, i), k_cover_mask, sizeof(k_cover_mask));
+        aabb_soa_set(&sim->cover_boxes, i, sx_rect_move(sim->bounds.cover, sim->covers[i].pos));
+    }
+
+    player_t* player = &sim->player;
+    player->pos = sx_vec2f(0, -GAME_BOARD_HEIGHT * 0.5f + tile_size * 2.0f);
+    player->bullet_tm = PLAYER_BULLET_INTERVAL;
+
+    sim->num_bullets = 0;
+    sim->num_bullet_order = 0;
+    sim->num_explosions = 0;
+    pool_clear(&sim->bullet_pool);
+    pool_clear(&sim->explosion_pool);
+
+    sim->saucer.dead = true;
+
+    push_event(sim, (sim_event_t){ .type = SIM_EVENT_STOP_SOUNDS });
+
+    sim->player_lives = NUM_LIVES;
+    sim->stage = 0;
+}
+
+sim_config_t sim_default_config(void)
+{
+    return (sim_config_t){ .enemies_per_row = DEFAULT_ENEMIES_PER_ROW,
+                           .num_rows = DEFAULT_NUM_ROWS,
+                           .max_bullets = DEFAULT_MAX_BULLETS,
+                           .max_explosions = DEFAULT_MAX_EXPLOSIONS,
+                           .num_covers = DEFAULT_NUM_COVERS,
+                           .broadphase = SIM_BROADPHASE_FORMATION };
+}
+
+// clang-format off
+static const int k_enemy_hit_scores[ENEMY_KIND_COUNT] = {
+    10,
+    15,
+    20
+};
+
+static const sound_type_t k_enemy_explode_sounds[ENEMY_KIND_COUNT] = {
+    SOUND_EXPLODE3,
+    SOUND_EXPLODE1,
+    SOUND_EXPLODE2
+};
+// clang-format on
+
+// returns the number of bytes needed for `data` of `count` enemies, a multiple of 8
+static size_t enemies_data_size(int count)
+{
+    size_t size = sx_bitarray_bytesize(count) + (sizeof(sx_vec2) + sizeof(uint8_t)) * (size_t)count;
+    return sx_align_mask(size, 7);
+}
+
+// data: zeroed block of `enemies_data_size` bytes, aligned to 8
+static void init_enemies(sim_enemies_t* enemies, void* data, int count)
+{
+    uint8_t* buff = data;
+    sx_bitarray_init(&enemies->alive, buff, sx_bitarray_bytesize(count), count);
+    buff += sx_bitarray_bytesize(count);
+    enemies->pos = (sx_vec2*)buff;
+    buff += sizeof(sx_vec2) * count;
+    enemies->kind = buff;
+}
+
+// kind of the enemies in each row, top rows have the highest scores
+// 1/5 of the rows from the top are enemy2, the next 2/5 enemy3 and the rest are enemy1
+static enemy_kind_t enemy_kind_of_row(int row, int num_rows)
+{
+    int band = (row * 5) / num_rows;
+    return band == 0 ? ENEMY_KIND_2 : (band < 3 ? ENEMY_KIND_3 : ENEMY_KIND_1);
+}
+
+bool sim_init(sim_state_t* sim, const sx_alloc* alloc, const sim_config_t* config, uint32_t seed)
+{
+    sim_config_t conf = config ? *config : sim_default_config();
+    const bool use_grid = conf.broadphase == SIM_BROADPHASE_GRID;
+    sx_assert(conf.enemies_per_row > 0 && conf.num_rows > 0);
+    sx_assert(conf.max_bullets > 0 && conf.max_explosions > 0 && conf.num_covers >= 0);
+
+    sx_memset(sim, 0x0, sizeof(*sim));
+    sim->config = conf;
+    sim->min_bullets_per_job = SIM_MIN_BULLETS_PER_JOB;
+    sim->num_enemies = conf.enemies_per_row * conf.num_rows;
+
+    sim->tile_size = GAME_BOARD_WIDTH / 15.0f;
+    if (conf.enemies_per_row > DEFAULT_ENEMIES_PER_ROW || conf.num_rows > DEFAULT_NUM_ROWS) {
+        // keep the same margins as the original formation: 2 tiles on each side to move in, and
+        // 13 tiles between the formation and the bottom of the board
+        sim->tile_size = sx_min(GAME_BOARD_WIDTH / (float)(conf.enemies_per_row + 4),
+                                GAME_BOARD_HEIGHT / (float)(conf.num_rows + 13));
+    }
+
+    // enemies are a tile apart, so with tile sized cells there is about one enemy in each cell
+    sx_rect grid_area = sx_rectf(-GAME_BOARD_WIDTH * 0.5f - sim->tile_size,
+                                 -GAME_BOARD_HEIGHT * 0.5f - sim->tile_size,
+                                 GAME_BOARD_WIDTH * 0.5f + sim->tile_size,
+                                 GAME_BOARD_HEIGHT * 0.5f + sim->tile_size);
+    int grid_cells_sz = use_grid ? grid_cell_start_size(grid_area, sim->tile_size) : 0;
+    int grid_items_sz = use_grid ? sim->num_enemies : 0;
+
+    int hits_sz = sx_max(conf.max_bullets, sim->num_enemies);
+    int hash_items_sz = conf.num_covers + 2;    // + saucer and player
+    int hash_buckets_sz = shash_bucket_start_size(hash_items_sz);
+    int boxes_sz = aabb_soa_data_size(sim->num_enemies) + aabb_soa_data_size(conf.max_bullets) +
+                   aabb_soa_data_size(conf.num_covers);
+
+    // single allocation for all entity arrays, boxes are at the end with padding for alignment
+    size_t enemies_sz = enemies_data_size(sim->num_enemies);
+    size_t total_sz = enemies_sz + sizeof(int) * sim->num_enemies +
+                      sizeof(int) * conf.enemies_per_row +
+                      sizeof(int) * (grid_items_sz + grid_cells_sz) + sizeof(cover_t) * conf.num_covers +
+                      (sizeof(bullet_t) + sizeof(int) * 3 + sizeof(uint8_t)) * conf.max_bullets +
+                      sizeof(sim_hit_t) * hits_sz + sizeof(shash_item_t) * hash_items_sz +
+                      sizeof(int) * (shash_max_entries(hash_items_sz) + hash_buckets_sz) +
+                      sizeof(explosion_t) * conf.max_explosions + sizeof(float) * boxes_sz +
+                      sizeof(uint32_t) * (pool_data_size(conf.max_bullets) +
+                                          pool_data_size(conf.max_explosions)) +
+                      AABB_ALIGN + sizeof(k_cover_mask) * conf.num_covers;
+    uint8_t* buff = sx_malloc(alloc, total_sz);
+    if (!buff) {
+        sx_out_of_memory();
+        return false;
+    }
+    sx_memset(buff, 0x0, total_sz);
+
+    init_enemies(&sim->enemies, buff, sim->num_enemies);
+    buff += enemies_sz;
+    sim->bullets = (bullet_t*)buff;
+    buff += sizeof(bullet_t) * conf.max_bullets;
+    sim->hits = (sim_hit_t*)buff;
+    buff += sizeof(sim_hit_t) * hits_sz;
+    sim->bullet_order = (int*)buff;
+    buff += sizeof(int) * conf.max_bullets;
+    sim->bullet_rank = (int*)buff;
+    buff += sizeof(int) * conf.max_bullets;
+    sim->bullet_pairs = (int*)buff;
+    buff += sizeof(int) * conf.max_bullets;
+    sim->explosions = (explosion_t*)buff;
+    buff += sizeof(explosion_t) * conf.max_explosions;
+    sim->covers = (cover_t*)buff;
+    buff += sizeof(cover_t) * conf.num_covers;
+    sx_bitarray_init(&sim->cover_masks, buff, sizeof(k_cover_mask) * conf.num_covers,
+                     64 * COVER_MASK_HEIGHT * conf.num_covers);
+    buff += sizeof(k_cover_mask) * conf.num_covers;
+    sim->alive_enemies = (int*)buff;
+    buff += sizeof(int) * sim->num_enemies;
+    sim->column_bottom = (int*)buff;
+    buff += sizeof(int) * conf.enemies_per_row;
+    pool_init(&sim->bullet_pool, (uint32_t*)buff, conf.max_bullets);
+    buff += sizeof(uint32_t) * pool_data_size(conf.max_bullets);
+    pool_init(&sim->explosion_pool, (uint32_t*)buff, conf.max_explosions);
+    buff += sizeof(uint32_t) * pool_data_size(conf.max_explosions);
+    shash_item_t* hash_items = (shash_item_t*)buff;
+    buff += sizeof(shash_item_t) * hash_items_sz;
+    int* hash_entries = (int*)buff;
+    buff += sizeof(int) * shash_max_entries(hash_items_sz);
+    int* hash_bucket_start = (int*)buff;
+    buff += sizeof(int) * hash_buckets_sz;
+    int* grid_items = (int*)buff;
+    buff += sizeof(int) * grid_items_sz;
+    int* grid_cell_start = (int*)buff;
+    buff += sizeof(int) * grid_cells_sz;
+    sim->bullet_claimed = buff;
+    buff += sizeof(uint8_t) * conf.max_bullets;
+    float* boxes = (float*)sx_align_mask((uintptr_t)buff, (uintptr_t)AABB_ALIGN - 1);
+    aabb_soa_init(&sim->enemy_boxes, boxes, sim->num_enemies);
+    boxes += aabb_soa_data_size(sim->num_enemies);
+    aabb_soa_init(&sim->bullet_boxes, boxes, conf.max_bullets);
+    boxes += aabb_soa_data_size(conf.max_bullets);
+    aabb_soa_init(&sim->cover_boxes, boxes, conf.num_covers);
+
+    sx_rng_seed(&sim->rng, seed);
+
+    // covers are evenly spaced with the same gaps between them
+    sim->cover_size = GAME_BOARD_WIDTH / (float)(conf.num_covers * 2 + 1);
+    sim->enemy_shoot_interval = ENEMY_SHOOT_INTERVAL;
+    init_bounds(&sim->bounds, sim->tile_size, sim->cover_size);
+
+    if (use_grid) {
+        grid_init(&sim->enemy_grid, grid_area, sim->tile_size, sim->bounds.enemy_max,
+                  grid_cell_start, grid_items);
+    }
+
+    // cells fit the biggest item, so each one is in 4 cells at most
+    const sim_bounds_t* b = &sim->bounds;
+    float hash_cell_size = sx_max(sx_max(sx_rect_width(b->cover), sx_rect_height(b->cover)),
+                                  sx_max(sx_rect_width(b->saucer), sx_rect_height(b->saucer)));
+    hash_cell_size = sx_max(hash_cell_size,
+                            sx_max(sx_rect_width(b->player), sx_rect_height(b->player)));
+    shash_init(&sim->world_hash, hash_cell_size, hash_items_sz, hash_items, hash_entries,
+               hash_bucket_start);
+
+    for (int i = 0; i < sim->num_enemies; i++) {
+        sim->enemies.kind[i] = (uint8_t)enemy_kind_of_row(i / conf.enemies_per_row, conf.num_rows);
+    }
+
+    float tile_size = sim->cover_size;
+    float half_width = GAME_BOARD_WIDTH * 0.5f;
+    float cover_y = -GAME_BOARD_HEIGHT * 0.5f + GAME_BOARD_WIDTH / 9.0f * 2.0f;
+    int count = 0;
+    for (float x = -half_width + tile_size; x < half_width && count < conf.num_covers;
+         x += tile_size * 2.0f) {
+        cover_t* cover = &sim->covers[count++];
+        cover->pos = sx_vec2f(x, cover_y);
+    }
+
+    sim->player.speed = 0.1f;
+    sim->saucer = (saucer_t){ .dead = true,
+                              .wait_duration = 30.0f + (sx_rng_genf(&sim->rng) * 20.0f - 10.0f),
+                              .hit_score = 100 };
+
+    sim_refresh(sim);
+    sim->num_events = 0;
+    return true;
+}
+
+void sim_release(sim_state_t* sim, const sx_alloc* alloc)
+{
+    // enemies are the start of the entity arrays block
+    sx_free(alloc, sim->enemies.alive.ptr);
+    sx_memset(sim, 0x0, sizeof(*sim));
+}
+
+void sim_copy(sim_state_t* dst, const sim_state_t* src)
+{
+    sx_assert(dst->num_enemies == src->num_enemies);
+    sx_assert(dst->config.max_bullets == src->config.max_bullets);
+    sx_assert(dst->config.max_explosions == src->config.max_explosions);
+    sx_assert(dst->config.num_covers == src->config.num_covers);
+
+    sim_enemies_t enemies = dst->enemies;
+    cover_t* covers = dst->covers;
+    bullet_t* bullets = dst->bullets;
+    sim_hit_t* hits = dst->hits;
+    int* bullet_order = dst->bullet_order;
+    int* bullet_rank = dst->bullet_rank;
+    int* bullet_pairs = dst->bullet_pairs;
+    uint8_t* bullet_claimed = dst->bullet_claimed;
+    explosion_t* explosions = dst->explosions;
+    int* alive_enemies = dst->alive_enemies;
+    int* column_bottom = dst->column_bottom;
+    int* grid_cell_start = dst->enemy_grid.cell_start;
+    int* grid_items = dst->enemy_grid.items;
+    shash_t world_hash = dst->world_hash;
+    pool_t bullet_pool = dst->bullet_pool;
+    pool_t explosion_pool = dst->explosion_pool;
+    aabb_soa_t enemy_boxes = dst->enemy_boxes;
+    aabb_soa_t bullet_boxes = dst->bullet_boxes;
+    aabb_soa_t cover_boxes = dst->cover_boxes;
+    sx_bitarray cover_masks = dst->cover_masks;
+
+    sx_memcpy(dst, src, sizeof(*dst));
+    sx_memcpy(enemies.alive.ptr, src->enemies.alive.ptr, enemies_data_size(src->num_enemies));
+    sx_memcpy(covers, src->covers, sizeof(cover_t) * src->config.num_covers);
+    sx_memcpy(cover_masks.ptr, src->cover_masks.ptr, sizeof(k_cover_mask) * src->config.num_covers);
+    sx_memcpy(bullets, src->bullets, sizeof(bullet_t) * src->num_bullets);
+    sx_memcpy(hits, src->hits, sizeof(sim_hit_t) * src->num_hits);
+    sx_memcpy(bullet_order, src->bullet_order, sizeof(int) * src->num_bullet_order);
+    sx_memcpy(bullet_rank, src->bullet_rank, sizeof(int) * src->num_bullets);
+    sx_memcpy(explosions, src->explosions, sizeof(explosion_t) * src->num_explosions);
+    sx_memcpy(alive_enemies, src->alive_enemies, sizeof(int) * src->num_alive_enemies);
+    sx_memcpy(column_bottom, src->column_bottom, sizeof(int) * src->config.enemies_per_row);
+
+    dst->enemies = enemies;
+    dst->covers = covers;
+    dst->bullets = bullets;
+    dst->hits = hits;
+    dst->bullet_order = bullet_order;
+    dst->bullet_rank = bullet_rank;
+    dst->bullet_pairs = bullet_pairs;
+    dst->bullet_claimed = bullet_claimed;
+    dst->explosions = explosions;
+    dst->alive_enemies = alive_enemies;
+    dst->column_bottom = column_bottom;
+
+    pool_copy(&bullet_pool, &src->bullet_pool);
+    pool_copy(&explosion_pool, &src->explosion_pool);
+    dst->bullet_pool = bullet_pool;
+    dst->explosion_pool = explosion_pool;
+
+    aabb_soa_copy(&enemy_boxes, &src->enemy_boxes);
+    aabb_soa_copy(&bullet_boxes, &src->bullet_boxes);
+    aabb_soa_copy(&cover_boxes, &src->cover_boxes);
+    dst->enemy_boxes = enemy_boxes;
+    dst->bullet_boxes = bullet_boxes;
+    dst->cover_boxes = cover_boxes;
+    dst->cover_masks = cover_masks;
+
+    const shash_t* hash = &src->world_hash;
+    sx_memcpy(world_hash.items, hash->items, sizeof(shash_item_t) * hash->num_items);
+    sx_memcpy(world_hash.entries, hash->entries, sizeof(int) * hash->num_entries);
+    sx_memcpy(world_hash.bucket_start, hash->bucket_start, sizeof(int) * (hash->num_buckets + 1));
+    world_hash.num_items = hash->num_items;
+    world_hash.num_entries = hash->num_entries;
+    dst->world_hash = world_hash;
+
+    const grid_t* grid = &src->enemy_grid;
+    if (grid->cell_start) {
+        sx_memcpy(grid_cell_start, grid->cell_start, sizeof(int) * (grid->cols * grid->rows + 1));
+        sx_memcpy(grid_items, grid->items, sizeof(int) * grid->num_items);
+        dst->enemy_grid.cell_start = grid_cell_start;
+        dst->enemy_grid.items = grid_items;
+    }
+}
+
+// drops removed bullets from the order
+static void compact_bullet_order(sim_state_t* sim)
+{
+    int* order = sim->bullet_order;
+    int count = 0;
+    for (int i = 0; i < sim->num_bullet_order; i++) {
+        int index = order[i];
+        if (index != -1) {
+            sim->bullet_rank[index] = count;
+            order[count++] = index;
+        }
+    }
+    sim->num_bullet_order = count;
+}
+
+// returns POOL_INVALID_HANDLE when all `max_bullets` are in flight, the bullet is not created
+static pool_handle_t create_bullet(sim_state_t* sim, sx_vec2 pos, bullet_type_t type)
+{
+    sx_assert(type < BULLET_TYPE_COUNT);
+
+    static const float bullet_speeds[BULLET_TYPE_COUNT] = { 1.5f, 0.75f };
+    static const int bullet_damages[BULLET_TYPE_COUNT] = { 10, 20 };
+
+    bullet_t bullet = { .pos = pos,
+                        .type = type,
+                        .damage = bullet_damages[type],
+                        .speed =
+                            bullet_speeds[type] * (type == BULLET_TYPE_PLAYER ? 1.0f : -1.0f) };
+
+    int index = sim->num_bullets;
+    pool_handle_t handle = pool_add(&sim->bullet_pool, index);
+    if (handle == POOL_INVALID_HANDLE) {
+        return handle;
+    }
+    ++sim->num_bullets;
+
+    if (sim->num_bullet_order == sim->config.max_bullets) {
+        compact_bullet_order(sim);
+    }
+    sim->bullet_rank[index] = sim->num_bullet_order;
+    sim->bullet_order[sim->num_bullet_order++] = index;
+
+    sim->bullets[index] = bullet;
+    aabb_soa_set(&sim->bullet_boxes, index, sx_rect_move(sim->bounds.bullets[type], pos));
+    return handle;
+}
+
+pool_handle_t sim_add_bullet(sim_state_t* sim, sx_vec2 pos, bullet_type_t type)
+{
+    return create_bullet(sim, pos, type);
+}
+
+static pool_handle_t create_explosion(sim_state_t* sim, sx_vec2 pos, explosion_type_t type)
+{
+    int index = sim->num_explosions;
+    pool_handle_t handle = pool_add(&sim->explosion_pool, index);
+    if (handle != POOL_INVALID_HANDLE) {
+        sim->explosions[index] = (explosion_t){ .pos = pos, .type = type };
+        ++sim->num_explosions;
+    }
+    return handle;
+}
+
+static void remove_bullet(sim_state_t* sim, int index)
+{
+    pool_remove(&sim->bullet_pool, index, sim->num_bullets);
+
+    int last = sim->num_bullets - 1;
+    sim->bullet_order[sim->bullet_rank[index]] = -1;
+    if (index < last) {
+        sim->bullets[index] = sim->bullets[last];
+        aabb_soa_copy_box(&sim->bullet_boxes, index, last);
+        sim->bullet_rank[index] = sim->bullet_rank[last];
+        sim->bullet_order[sim->bullet_rank[index]] = index;
+    }
+
+    --sim->num_bullets;
+}
+
+// O(1) for the formation, then the alive enemies take their positions from it
+static void update_formation(sim_state_t* sim, float dt)
+{
+    sim_formation_t* f = &sim->formation;
+    f->move_tm += dt;
+    if (f->move_tm >= FORMATION_MOVE_DURATION) {
+        // every enemy has finished the move, so it goes into the offset
+        f->offset = sx_vec2_add(f->offset, formation_move(sim));
+        f->move_tm = 0;
+        if (f->dir == ENEMY_MOVEMENT_LEFT) {
+            if (--f->xstep <= -2) {
+                f->dir = ENEMY_MOVEMENT_DOWN;
+            }
+        } else if (f->dir == ENEMY_MOVEMENT_RIGHT) {
+            if (++f->xstep >= 2) {
+                f->dir = ENEMY_MOVEMENT_DOWN;
+            }
+        } else {
+            f->dir = f->xstep < 0 ? ENEMY_MOVEMENT_RIGHT : ENEMY_MOVEMENT_LEFT;
+        }
+    }
+
+    update_enemy_positions(sim);
+}
+
+static void spawn_saucer(sim_state_t* sim)
+{
+    float side = sx_sign(sx_rng_genf(&sim->rng) * 2.0f - 1.0f);
+    if (side == 0) {
+        side = 1.0f;
+    }
+
+    saucer_t* saucer = &sim->saucer;
+    saucer->pos.x = side * (GAME_BOARD_WIDTH * 0.5f + sim->tile_size);
+    saucer->pos.y = GAME_BOARD_HEIGHT * 0.5f - sim->tile_size;
+    saucer->speed = -side * 0.3f;
+    saucer->wait_duration = 30.0f + (sx_rng_genf(&sim->rng) * 20.0f - 10.0f);
+    saucer->dead = false;
+
+    play_sound(sim, SOUND_SAUCER, 0);
+}
+
+static void update_player(sim_state_t* sim, const sim_input_t* input, float dt)
+{
+    if (sim->player_died) {
+        return;
+    }
+
+    player_t* player = &sim->player;
+    float speed = 0.4f;
+    float half_width = sx_rect_width(sim->bounds.player) * 0.5f;
+    ++sim->num_bounds_lookups;
+    float right_limit = GAME_BOARD_WIDTH * 0.5f - half_width - sim->tile_size * 0.1f;
+    float left_limit = -GAME_BOARD_WIDTH * 0.5f + half_width + sim->tile_size * 0.1f;
+
+    if (input->left) {
+        player->pos.x -= dt * speed;
+        player->pos.x = sx_max(left_limit, player->pos.x);
+    }
+
+    if (input->right) {
+        player->pos.x += dt * speed;
+        player->pos.x = sx_min(right_limit, player->pos.x);
+    }
+
+    { // analog stick
+        float movex_analog = input->movex;
+        movex_analog = sx_sign(movex_analog) * sx_easeout_quad(sx_abs(movex_analog));
+        speed = movex_analog * speed;
+        player->pos.x += dt * speed;
+        player->pos.x = sx_clamp(player->pos.x, left_limit, right_limit);
+    }
+
+    player->bullet_tm += dt;
+    if (input->shoot && !sim->enemy_explosion) {
+        if (player->bullet_tm > PLAYER_BULLET_INTERVAL) {
+            ++sim->num_bounds_lookups;
+            create_bullet(sim,
+                          sx_vec2f(player->pos.x,
+                                   player->pos.y + sx_rect_height(sim->bounds.player) * 0.5f),
+                          BULLET_TYPE_PLAYER);
+            player->bullet_tm = 0;
+
+            play_sound(sim, SOUND_SHOOT, 0);
+        }
+    }
+}
+
+static void build_enemy_grid(sim_state_t* sim)
+{
+    grid_build(&sim->enemy_grid, sim->enemies.pos, sizeof(sx_vec2), sim->alive_enemies,
+               sim->num_alive_enemies);
+}
+
+// only tests the enemies in the grid cells around the bullet, enemies that are killed after the
+// grid is built are skipped
+// player bullets move up, so the enemy with the lowest bottom is hit first, ties go to the lower
+// index so the result doesn't depend on the order enemies are visited
+static inline bool is_earlier_enemy_hit(const sim_state_t* sim, int index, int hit_index)
+{
+    float ymin = sim->enemy_boxes.ymin[index];
+    float hit_ymin = sim->enemy_boxes.ymin[hit_index];
+    return ymin < hit_ymin || (ymin == hit_ymin && index < hit_index);
+}
+
+static int find_enemy_hit_grid(const sim_state_t* sim, sx_rect bullet_rect, sim_hit_t* hit)
+{
+    const grid_t* grid = &sim->enemy_grid;
+    c2AABB bullet_aabb = rect_to_aabb(bullet_rect);
+    grid_range_t range = grid_query_range(grid, bullet_rect);
+    int hit_index = -1;
+
+    for (int y = range.ymin; y <= range.ymax; y++) {
+        for (int x = range.xmin; x <= range.xmax; x++) {
+            int cell = grid_cell(grid, x, y);
+            int start = grid->cell_start[cell], end = grid->cell_start[cell + 1];
+            hit->num_candidates += end - start;
+            for (int k = start; k < end; k++) {
+                int index = grid->items[k];
+                if (!sim_enemy_alive(sim, index)) {
+                    continue;
+                }
+                ++hit->num_tests;
+                ++hit->num_bounds_lookups;
+
+                c2AABB enemy_aabb = rect_to_aabb(sx_rect_move(
+                    sim->bounds.enemies[sim->enemies.kind[index]], sim->enemies.pos[index]));
+                if (c2AABBtoAABB(bullet_aabb, enemy_aabb) &&
+                    (hit_index == -1 || is_earlier_enemy_hit(sim, index, hit_index))) {
+                    hit_index = index;
+                }
+            }
+        }
+    }
+
+    return hit_index;
+}
+
+static inline int clamp_floor(float v, int _max)
+{
+    return (int)sx_floor(sx_clamp(v, -1.0f, (float)_max + 1.0f));
+}
+
+// enemies move in lockstep: every alive enemy is displaced from it's layout position by the
+// formation offset, plus at most one tile of the move in progress
+// so the rows/columns that can overlap the bullet are known without looking at the enemies
+static int find_enemy_hit_formation(const sim_state_t* sim, sx_rect bullet_rect, sim_hit_t* hit)
+{
+    const float inv_tile_size = 1.0f / sim->tile_size;
+    const int enemies_per_row = sim->config.enemies_per_row;
+    const sx_rect eb = sim->bounds.enemy_max;
+    const float slack = 1.01f;    // one tile for the move in progress, and some for rounding
+    sx_vec2 origin = sx_vec2_add(sim->formation_pos, sim->formation.offset);
+
+    // columns go along +x and rows along -y
+    int col_min = clamp_floor((bullet_rect.xmin - eb.xmax - origin.x) * inv_tile_size - slack,
+                              enemies_per_row) + 1;
+    int col_max = clamp_floor((bullet_rect.xmax - eb.xmin - origin.x) * inv_tile_size + slack,
+                              enemies_per_row);
+    int row_min = clamp_floor((origin.y - bullet_rect.ymax + eb.ymin) * inv_tile_size - slack,
+                              sim->config.num_rows) + 1;
+    int row_max = clamp_floor((origin.y - bullet_rect.ymin + eb.ymax) * inv_tile_size + slack,
+                              sim->config.num_rows);
+    col_min = sx_max(col_min, 0);
+    col_max = sx_min(col_max, enemies_per_row - 1);
+    row_min = sx_max(row_min, 0);
+    row_max = sx_min(row_max, sim->config.num_rows - 1);
+
+    // columns of a row are contiguous, dead enemies have empty boxes. the kernel tests all of them
+    if (row_min <= row_max && col_min <= col_max) {
+        int num_boxes = (row_max - row_min + 1) * (col_max - col_min + 1);
+        hit->num_candidates += num_boxes;
+        hit->num_tests += num_boxes;
+        hit->num_bounds_lookups += num_boxes;
+    }
+    int hit_index = -1;
+    for (int row = row_min; row <= row_max && col_min <= col_max; row++) {
+        int start = row * enemies_per_row + col_min;
+        int end = row * enemies_per_row + col_max + 1;
+        for (int index = aabb_first_overlap(&sim->enemy_boxes, start, end, bullet_rect);
+             index != -1; index = aabb_first_overlap(&sim->enemy_boxes, index + 1, end, bullet_rect)) {
+            if (hit_index == -1 || is_earlier_enemy_hit(sim, index, hit_index)) {
+                hit_index = index;
+            }
+        }
+    }
+
+    return hit_index;
+}
+
+// bullet_rect: box swept by a player bullet over the step
+// returns the enemy the bullet hits first, or -1. the work is counted in `hit`
+static int find_enemy_hit(const sim_state_t* sim, sx_rect bullet_rect, sim_hit_t* hit)
+{
+    return sim->config.broadphase == SIM_BROADPHASE_GRID
+               ? find_enemy_hit_grid(sim, bullet_rect, hit)
+               : find_enemy_hit_formation(sim, bullet_rect, hit);
+}
+
+typedef struct bullet_hits_data_t {
+    sim_state_t* sim;
+    float dt;
+} bullet_hits_data_t;
+
+// bullets only move along y, so the box swept over the step is the union of the start and end boxes
+static inline sx_rect sweep_bullet_rect(sx_rect start_rect, float dy)
+{
+    if (dy > 0) {
+        start_rect.ymax += dy;
+    } else {
+        start_rect.ymin += dy;
+    }
+    return start_rect;
+}
+
+// time of impact [0, 1] of a bullet box moving by `dy` from `start_rect`, with `target` that
+// overlaps the swept box
+static inline float sweep_toi(sx_rect start_rect, float dy, sx_rect target)
+{
+    if (dy == 0) {
+        return 0;
+    }
+    float dist = dy > 0 ? (target.ymin - start_rect.ymax) : (start_rect.ymin - target.ymax);
+    return sx_clamp(dist / sx_abs(dy), 0.0f, 1.0f);
+}
+
+static const uint32_t k_bullet_layers[BULLET_TYPE_COUNT] = { SIM_LAYER_PLAYER_BULLET,
+                                                             SIM_LAYER_ALIEN_BULLET };
+static const uint32_t k_bullet_masks[BULLET_TYPE_COUNT] = {
+    SIM_LAYER_ENEMY | SIM_LAYER_SAUCER | SIM_LAYER_COVER | SIM_LAYER_ALIEN_BULLET,
+    SIM_LAYER_PLAYER | SIM_LAYER_COVER | SIM_LAYER_PLAYER_BULLET
+};
+
+static inline void add_bullet_hit(sim_hit_t* hit, sim_hit_type_t type, int target, float toi)
+{
+    if (toi < hit->toi) {
+        hit->type = (uint8_t)type;
+        hit->target = target;
+        hit->toi = toi;
+    }
+}
+
+// tests the pixel rows of cover `index` under the swept bullet box in the order the bullet
+// crosses them, the first row that has any pixel under the bullet's columns is the hit
+static void add_cover_hit(const sim_state_t* sim, sim_hit_t* hit, int index, sx_rect start_rect,
+                          float dy)
+{
+    cover_pixels_t range;
+    ++hit->num_bounds_lookups;
+    if (!cover_pixel_range(sim, index, sweep_bullet_rect(start_rect, dy), &range)) {
+        return;
+    }
+
+    const uint64_t* rows = cover_mask_rows(sim, index);
+    uint64_t cols = cover_mask_cols(range.xmin, range.xmax);
+    int first = dy > 0 ? range.ymax : range.ymin;
+    int last = dy > 0 ? range.ymin : range.ymax;
+    int step = dy > 0 ? -1 : 1;
+    for (int y = first; y != last + step; y += step) {
+        if (rows[y] & cols) {
+            ++hit->num_bounds_lookups;
+            float toi = sweep_toi(start_rect, dy, cover_row_rect(sim, index, y));
+            if (toi < hit->toi) {
+                add_bullet_hit(hit, SIM_HIT_COVER, index, toi);
+                hit->pixel_x = (uint8_t)((range.xmin + range.xmax) / 2);
+                hit->pixel_y = (uint8_t)y;
+            }
+            return;
+        }
+    }
+}
+
+// same inclusive test as the enemy boxes, an empty formation box overlaps nothing
+static inline bool overlaps_formation(const sim_state_t* sim, sx_rect rc)
+{
+    const sx_rect fb = sim->formation_box;
+    return rc.xmax >= fb.xmin && fb.xmax >= rc.xmin && rc.ymax >= fb.ymin && fb.ymax >= rc.ymin;
+}
+
+// earliest hit of bullet `index` moving from `start_pos` over the step, in the current world.
+// on ties the first check below wins
+static sim_hit_t find_bullet_hit(const sim_state_t* sim, int index, sx_vec2 start_pos, float dt)
+{
+    const bullet_t* bullet = &sim->bullets[index];
+    float dy = bullet->speed * dt;
+    sx_rect start_rect = sx_rect_move(sim->bounds.bullets[bullet->type], start_pos);
+    sx_rect sweep_rect = sweep_bullet_rect(start_rect, dy);
+
+    sim_hit_t hit = { .type = SIM_HIT_NONE,
+                      .source = index,
+                      .bullet = pool_handle(&sim->bullet_pool, index),
+                      .toi = SX_FLOAT_MAX,
+                      .num_bounds_lookups = 1 };
+    uint32_t mask = k_bullet_masks[bullet->type];
+    if ((mask & SIM_LAYER_ENEMY) && overlaps_formation(sim, sweep_rect)) {
+        int enemy_index = find_enemy_hit(sim, sweep_rect, &hit);
+        if (enemy_index != -1) {
+            ++hit.num_bounds_lookups;
+            sx_rect enemy_rect = sx_rect_move(sim->bounds.enemies[sim->enemies.kind[enemy_index]],
+                                              sim->enemies.pos[enemy_index]);
+            add_bullet_hit(&hit, SIM_HIT_ENEMY, enemy_index, sweep_toi(start_rect, dy, enemy_rect));
+        }
+    }
+
+    // the boxes are only candidates, covers are tested again with their pixels. the hash is built
+    // once per step, so targets killed by earlier hits of the step are still in it and are skipped
+    // here for the bullets that look again in resolve_bullet_hit
+    int items[SIM_MAX_HASH_CANDIDATES];
+    int num_found = shash_query(&sim->world_hash, sweep_rect, mask, items, SIM_MAX_HASH_CANDIDATES);
+    int num_items = sx_min(num_found, SIM_MAX_HASH_CANDIDATES);
+    hit.num_candidates_dropped = num_found - num_items;
+    hit.num_candidates += num_items;
+    hit.num_tests += num_items;
+    hit.num_bounds_lookups += num_items;
+    for (int i = 0; i < num_items; i++) {
+        const shash_item_t* item = &sim->world_hash.items[items[i]];
+        switch (item->layer) {
+        case SIM_LAYER_SAUCER:
+            if (!sim->saucer.dead) {
+                add_bullet_hit(&hit, SIM_HIT_SAUCER, 0, sweep_toi(start_rect, dy, item->box));
+            }
+            break;
+        case SIM_LAYER_PLAYER:
+            if (!sim->player_died) {
+                add_bullet_hit(&hit, SIM_HIT_PLAYER, 0, sweep_toi(start_rect, dy, item->box));
+            }
+            break;
+        case SIM_LAYER_COVER:
+            if (!sim->covers[item->id].dead) {
+                add_cover_hit(sim, &hit, item->id, start_rect, dy);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // bounds are checked after the hits, so bullets leaving the board can still hit things
+    // they pass on the way out (the saucer)
+    float end_y = start_pos.y + dy;
+    if (hit.type == SIM_HIT_NONE &&
+        (end_y >= GAME_BOARD_HEIGHT * 0.5f || end_y <= -GAME_BOARD_HEIGHT * 0.5f)) {
+        hit.type = SIM_HIT_BOUNDS;
+        hit.toi = 1.0f;
+    }
+
+    return hit;
+}
+
+// finds the hit of each bullet over this step's move and moves it. only reads the world and
+// writes to the bullet's own slots, so ranges can run in parallel
+static void find_bullet_hits_cb(int start, int end, int thrd_index, void* user)
+{
+    sx_unused(thrd_index);
+
+    const bullet_hits_data_t* hdata = user;
+    sim_state_t* sim = hdata->sim;
+
+    for (int i = start; i < end; i++) {
+        bullet_t* bullet = &sim->bullets[i];
+        sim->hits[i] = find_bullet_hit(sim, i, bullet->pos, hdata->dt);
+        bullet->pos.y += bullet->speed * hdata->dt;
+        aabb_soa_set(&sim->bullet_boxes, i,
+                     sx_rect_move(sim->bounds.bullets[bullet->type], bullet->pos));
+    }
+}
+
+// a hit is stale when an earlier hit in the step already took it's target
+static bool is_stale_hit(const sim_state_t* sim, const sim_hit_t* hit)
+{
+    switch (hit->type) {
+    case SIM_HIT_ENEMY:
+        return !sim_enemy_alive(sim, hit->target);
+    case SIM_HIT_SAUCER:
+        return sim->saucer.dead;
+    case SIM_HIT_PLAYER:
+        return sim->player_died;
+    case SIM_HIT_COVER:
+        return sim->covers[hit->target].dead;
+    default:
+        return false;
+    }
+}
+
+// sounds of the hits resolved in the step are played once each, in sound order
+static void play_hit_sounds(sim_state_t* sim, uint32_t sounds)
+{
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        if (sounds & (1u << i)) {
+            play_sound(sim, (sound_type_t)i, i == SOUND_BONUS ? 1 : 0);
+        }
+    }
+}
+
+static void kill_player(sim_state_t* sim)
+{
+    sx_assert(!sim->player_died);
+
+    sim->player_died = true;
+    sim->player_explosion.pos = sim->player.pos;
+    --sim->player_lives;
+}
+
+static void kill_saucer(sim_state_t* sim)
+{
+    saucer_t* saucer = &sim->saucer;
+
+    saucer->dead = true;
+
+    sim->enemy_explosion = true;
+    sim->enemy_explosion_tm = 0;
+    sim->enemy_explosion_pos = saucer->pos;
+
+    sim->player_score += saucer->hit_score;
+}
+
+// bullets never move along x, so the order of the last step is already sorted except for the new
+// bullets, and the insertion sort only moves those
+static void sort_bullet_order(sim_state_t* sim)
+{
+    compact_bullet_order(sim);
+
+    int* order = sim->bullet_order;
+    int* rank = sim->bullet_rank;
+    const int count = sim->num_bullet_order;
+    const float* xmin = sim->bullet_boxes.xmin;
+    sx_assert(count == sim->num_bullets);
+
+    for (int i = 1; i < count; i++) {
+        int index = order[i];
+        float x = xmin[index];
+        int j = i - 1;
+        while (j >= 0 && xmin[order[j]] > x) {
+            order[j + 1] = order[j];
+            rank[order[j + 1]] = j + 1;
+            j--;
+        }
+        order[j + 1] = index;
+        rank[index] = j + 1;
+    }
+}
+
+// sort-and-sweep along x, each bullet collides with at most one other bullet, the first one in
+// sweep order. bullets move along y by `speed * dt` in the step, relative to each other too, so
+// the y test sweeps one of them by the relative move against the other at it's end position
+static void collide_bullets(sim_state_t* sim, float dt, uint32_t* sounds)
+{
+    sort_bullet_order(sim);
+
+    const int* order = sim->bullet_order;
+    const int count = sim->num_bullet_order;
+    const float* xmin = sim->bullet_boxes.xmin;
+    const float* ymin = sim->bullet_boxes.ymin;
+    const float* xmax = sim->bullet_boxes.xmax;
+    const float* ymax = sim->bullet_boxes.ymax;
+
+    // candidates of a bullet are the ones after it, until their xmin passes it's xmax
+    uint8_t* claimed = sim->bullet_claimed;
+    int* pairs = sim->bullet_pairs;
+    int num_pairs = 0;
+    sx_memset(claimed, 0x0, sizeof(uint8_t) * count);
+    for (int i = 0; i < count; i++) {
+        int a = order[i];
+        if (claimed[a]) {
+            continue;
+        }
+
+        ++sim->num_bounds_lookups;
+        for (int j = i + 1; j < count && xmin[order[j]] <= xmax[a]; j++) {
+            int b = order[j];
+            ++sim->collision_stats.num_candidates;
+            if (claimed[b] ||
+                !(k_bullet_masks[sim->bullets[a].type] & k_bullet_layers[sim->bullets[b].type])) {
+                continue;
+            }
+            ++sim->collision_stats.num_tests;
+            ++sim->num_bounds_lookups;
+
+            float dy = (sim->bullets[a].speed - sim->bullets[b].speed) * dt;
+            float a_ymin = sx_min(ymin[a], ymin[a] - dy);
+            float a_ymax = sx_max(ymax[a], ymax[a] - dy);
+            if (ymax[b] >= a_ymin && a_ymax >= ymin[b]) {
+                claimed[a] = claimed[b] = 1;
+                pairs[num_pairs * 2] = a;
+                pairs[num_pairs * 2 + 1] = b;
+                ++num_pairs;
+                break;
+            }
+        }
+    }
+
+    sim->collision_stats.num_bullet_hits += (uint64_t)num_pairs;
+    for (int i = 0; i < num_pairs; i++) {
+        const bullet_t* a = &sim->bullets[pairs[i * 2]];
+        const bullet_t* b = &sim->bullets[pairs[i * 2 + 1]];
+        create_explosion(sim, sx_vec2_mulf(sx_vec2_add(a->pos, b->pos), 0.5f),
+                         EXPLOSION_TYPE_ENEMY);
+        *sounds |= 1u << SOUND_HIT;
+    }
+
+    // from the back, so removing doesn't move bullets that are not visited yet
+    if (num_pairs > 0) {
+        for (int i = sim->num_bullets - 1; i >= 0; i--) {
+            if (claimed[i]) {
+                remove_bullet(sim, i);
+            }
+        }
+    }
+}
+
+static void resolve_bullet_hit(sim_state_t* sim, sim_hit_t hit, float dt, uint32_t* sounds)
+{
+    // the bullet is found by it's handle, so it doesn't matter if it moved since the detection
+    hit.source = pool_index(&sim->bullet_pool, hit.bullet);
+    if (hit.source == -1) {
+        return;
+    }
+    bullet_t* bullet = &sim->bullets[hit.source];
+    float dy = bullet->speed * dt;
+
+    // a bullet that lost it's target looks again in what is left of the world
+    if (is_stale_hit(sim, &hit)) {
+        hit = find_bullet_hit(sim, hit.source, sx_vec2f(bullet->pos.x, bullet->pos.y - dy), dt);
+        sim->collision_stats.num_candidates += (uint64_t)hit.num_candidates;
+        sim->collision_stats.num_candidates_dropped += (uint64_t)hit.num_candidates_dropped;
+        sim->collision_stats.num_tests += (uint64_t)hit.num_tests;
+        sim->num_bounds_lookups += (uint64_t)hit.num_bounds_lookups;
+        if (hit.type == SIM_HIT_NONE || is_stale_hit(sim, &hit)) {
+            return;
+        }
+    }
+    ++sim->collision_stats.hits[hit.type];
+
+    // the bullet stops where it hits
+    bullet->pos.y += dy * (hit.toi - 1.0f);
+
+    switch (hit.type) {
+    case SIM_HIT_ENEMY: {
+        enemy_kind_t kind = (enemy_kind_t)sim->enemies.kind[hit.target];
+        kill_enemy(sim, hit.target);
+
+        // enter explosion state
+        sim->enemy_explosion = true;
+        sim->enemy_explosion_tm = 0;
+        sim->enemy_explosion_pos = sim->enemies.pos[hit.target];
+
+        sim->player_score += k_enemy_hit_scores[kind];
+
+        *sounds |= 1u << k_enemy_explode_sounds[kind];
+        break;
+    }
+    case SIM_HIT_SAUCER:
+        kill_saucer(sim);
+        *sounds |= 1u << SOUND_BONUS;
+        break;
+    case SIM_HIT_PLAYER:
+        kill_player(sim);
+        *sounds |= 1u << SOUND_EXPLODE4;
+        break;
+    case SIM_HIT_COVER:
+        // stronger bullets blow bigger holes
+        erode_cover(sim, hit.target, hit.pixel_x, hit.pixel_y, 2 + bullet->damage / 10);
+        create_explosion(sim, bullet->pos, EXPLOSION_TYPE_ENEMY);
+        *sounds |= 1u << SOUND_HIT;
+        break;
+    case SIM_HIT_BOUNDS:
+        if (bullet->pos.y <= -GAME_BOARD_HEIGHT * 0.5f) {
+            create_explosion(sim, sx_vec2f(bullet->pos.x, -GAME_BOARD_HEIGHT * 0.5f),
+                             EXPLOSION_TYPE_BOUNDS);
+        }
+        break;
+    default:
+        break;
+    }
+
+    sim->bullet_claimed[hit.source] = 1;
+}
+
+// registers everything that bullets can hit, except enemies and other bullets
+static void update_world_hash(sim_state_t* sim)
+{
+    shash_t* hash = &sim->world_hash;
+    shash_clear(hash);
+    if (!sim->saucer.dead) {
+        shash_add(hash, sx_rect_move(sim->bounds.saucer, sim->saucer.pos), SIM_LAYER_SAUCER, 0);
+    }
+    if (!sim->player_died) {
+        shash_add(hash, sx_rect_move(sim->bounds.player, sim->player.pos), SIM_LAYER_PLAYER, 0);
+    }
+    for (int i = 0; i < sim->config.num_covers; i++) {
+        if (!sim->covers[i].dead) {
+            shash_add(hash, sx_rect_move(sim->bounds.cover, sim->covers[i].pos), SIM_LAYER_COVER,
+                      i);
+        }
+    }
+    shash_build(hash);
+}
+
+// stage timers are only read with `time_collisions`, so the timer calls are skipped otherwise
+static inline uint64_t begin_stage(const sim_state_t* sim)
+{
+    return sim->time_collisions ? sx_tm_now() : 0;
+}
+
+// returns the start of the next stage
+static inline uint64_t end_stage(sim_state_t* sim, sim_collision_stage_t stage, uint64_t start_tm)
+{
+    if (!sim->time_collisions) {
+        return 0;
+    }
+    uint64_t now = sx_tm_now();
+    sim->collision_stats.stage_ticks[stage] += sx_tm_diff(now, start_tm);
+    return now;
+}
+
+static void update_bullets(sim_state_t* sim, float dt)
+{
+    // player bullets that don't touch the formation box skip the enemy broadphase, the rest of the
+    // detection is a hash lookup, so only the bullets left are worth a dispatch
+    int num_enemy_queries = 0;
+    int num_player_bullets = 0;
+    for (int i = 0; i < sim->num_bullets; i++) {
+        const bullet_t* bullet = &sim->bullets[i];
+        if (k_bullet_masks[bullet->type] & SIM_LAYER_ENEMY) {
+            sx_rect start_rect = sx_rect_move(sim->bounds.bullets[bullet->type], bullet->pos);
+            sx_rect sweep_rect = sweep_bullet_rect(start_rect, bullet->speed * dt);
+            num_enemy_queries += overlaps_formation(sim, sweep_rect) ? 1 : 0;
+            ++num_player_bullets;
+        }
+    }
+    sim_collision_stats_t* stats = &sim->collision_stats;
+    stats->num_enemy_queries += (uint64_t)num_enemy_queries;
+    stats->num_enemy_queries_rejected += (uint64_t)(num_player_bullets - num_enemy_queries);
+
+    // detection of all bullets with a single dispatch, nothing is applied until the resolve pass
+    uint64_t stage_tm = begin_stage(sim);
+    bullet_hits_data_t hdata = { .sim = sim, .dt = dt };
+    if (sim->jobs && num_enemy_queries >= sim->min_bullets_per_job) {
+        sx_job_t job = sim->jobs->dispatch(sim->num_bullets, find_bullet_hits_cb, &hdata,
+                                           SX_JOB_PRIORITY_NORMAL, 0);
+        sim->jobs->wait_and_del(job);
+    } else {
+        find_bullet_hits_cb(0, sim->num_bullets, 0, &hdata);
+    }
+    stage_tm = end_stage(sim, SIM_COLLISION_STAGE_DETECT, stage_tm);
+
+    // hits are compacted in place and resolved in bullet order, which doesn't depend on how the
+    // detection was split between threads. when two bullets hit the same target, the first one
+    // takes it and the later ones are detected again against what is left, so the lowest bullet
+    // index wins without any shared writes during detection
+    sim_hit_t* hits = sim->hits;
+    int num_hits = 0;
+    for (int i = 0; i < sim->num_bullets; i++) {
+        stats->num_candidates += (uint64_t)hits[i].num_candidates;
+        stats->num_candidates_dropped += (uint64_t)hits[i].num_candidates_dropped;
+        stats->num_tests += (uint64_t)hits[i].num_tests;
+        sim->num_bounds_lookups += (uint64_t)hits[i].num_bounds_lookups;
+        if (hits[i].type != SIM_HIT_NONE) {
+            hits[num_hits++] = hits[i];
+        }
+    }
+    sim->num_hits = num_hits;
+
+    uint32_t sounds = 0;
+    if (num_hits > 0) {
+        sx_memset(sim->bullet_claimed, 0x0, sizeof(uint8_t) * sim->num_bullets);
+        for (int i = 0; i < num_hits; i++) {
+            resolve_bullet_hit(sim, hits[i], dt, &sounds);
+        }
+
+        // from the back, so removing doesn't move bullets that are not visited yet
+        for (int i = sim->num_bullets - 1; i >= 0; i--) {
+            if (sim->bullet_claimed[i]) {
+                remove_bullet(sim, i);
+            }
+        }
+    }
+
+    // collision with other bullets is resolved for all of them after the moves
+    stage_tm = end_stage(sim, SIM_COLLISION_STAGE_RESOLVE, stage_tm);
+
+    collide_bullets(sim, dt, &sounds);
+    end_stage(sim, SIM_COLLISION_STAGE_BULLETS, stage_tm);
+    play_hit_sounds(sim, sounds);
+}
+
+static void update_explosions(sim_state_t* sim, float dt)
+{
+    for (int i = 0; i < sim->num_explosions; i++) {
+        explosion_t* explosion = &sim->explosions[i];
+        if (explosion->wait_tm >= ENEMY_EXPLODE_TIME) {
+            pool_remove(&sim->explosion_pool, i, sim->num_explosions);
+            if (i < sim->num_explosions - 1) {
+                sim->explosions[i] = sim->explosions[sim->num_explosions - 1];
+            }
+            --sim->num_explosions;
+
+            // the last explosion moved into `i`, it's checked in the next iteration
+            --i;
+            continue;
+        }
+
+        explosion->wait_tm += dt;
+    }
+}
+
+static int check_collision_with_covers(sim_state_t* sim, int index)
+{
+    sx_vec2 pos = sim->enemies.pos[index];
+    if (pos.y > 0) {
+        return -1;
+    }
+
+    // the scans read the cover boxes up to the hit, or all of them, and each pixel test reads the
+    // cover bounds again
+    int num_covers = sim->config.num_covers;
+    sx_rect rect = sx_rect_move(sim->bounds.enemies[sim->enemies.kind[index]], pos);
+    ++sim->num_bounds_lookups;
+    for (int i = aabb_first_overlap(&sim->cover_boxes, 0, num_covers, rect); i != -1;
+         i = aabb_first_overlap(&sim->cover_boxes, i + 1, num_covers, rect)) {
+        ++sim->collision_stats.num_candidates;
+        ++sim->collision_stats.num_tests;
+        ++sim->num_bounds_lookups;
+        if (cover_pixels_hit(sim, i, rect)) {
+            sim->num_bounds_lookups += (uint64_t)(i + 1);
+            return i;
+        }
+    }
+    sim->num_bounds_lookups += (uint64_t)num_covers;
+    return -1;
+}
+
+// the covers are below the formation, so only the bottom-most enemy of each column can reach them
+static int find_cover_contacts(sim_state_t* sim)
+{
+    int num_hits = 0;
+    for (int col = 0; col < sim->config.enemies_per_row; col++) {
+        int index = sim->column_bottom[col];
+        if (index == -1) {
+            continue;
+        }
+
+        int cover_index = check_collision_with_covers(sim, index);
+        if (cover_index != -1) {
+            sim->hits[num_hits++] = (sim_hit_t){ .type = SIM_HIT_ENEMY_COVER,
+                                                 .source = index,
+                                                 .target = cover_index };
+        }
+    }
+    sim->num_hits = num_hits;
+    return num_hits;
+}
+
+// same as covers, the bottom-most enemies are the first to reach the player
+static bool formation_reached_player(const sim_state_t* sim)
+{
+    float y = sim->player.pos.y + sim->tile_size * 0.5f;
+    for (int col = 0; col < sim->config.enemies_per_row; col++) {
+        int index = sim->column_bottom[col];
+        if (index != -1 && sim->enemies.pos[index].y <= y) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void resolve_cover_contact(sim_state_t* sim, sim_hit_t hit)
+{
+    enemy_kind_t kind = (enemy_kind_t)sim->enemies.kind[hit.source];
+    sx_vec2 pos = sim->enemies.pos[hit.source];
+
+    // the enemy tears out everything it touches
+    erode_cover_rect(sim, hit.target, sx_rect_move(sim->bounds.enemies[kind], pos));
+
+    sim->enemy_explosion = true;
+    sim->enemy_explosion_tm = 0;
+    sim->enemy_explosion_pos = pos;
+
+    play_sound(sim, k_enemy_explode_sounds[kind], 0);
+
+    kill_enemy(sim, hit.source);
+}
+
+void sim_step(sim_state_t* sim, const sim_input_t* input, float dt)
+{
+    sim->num_events = 0;
+    sim->num_bounds_lookups = 0;
+    sx_memset(&sim->collision_stats, 0x0, sizeof(sim->collision_stats));
+    sim->enemy_dt = 0;
+
+    if (sim->state != GAME_STATE_INGAME) {
+        sim->state_tm += dt;
+        if (sim->state_tm >= GAME_STATE_DURATION) {
+            sim_refresh(sim);
+            sim->state = GAME_STATE_INGAME;
+            push_event(sim, (sim_event_t){ .type = SIM_EVENT_STATE, .state = GAME_STATE_INGAME });
+        }
+        return;
+    }
+
+    float dtp = dt;
+    float dte;
+
+    if (sim->player_died) {
+        dt = 0;
+    }
+
+    update_player(sim, input, dt);
+
+    // update enemies
+    {
+        const int* alive_enemies = sim->alive_enemies;
+        const int num_alive = sim->num_alive_enemies;
+
+        if (num_alive == 0) {
+            // player won the game
+            ++sim->stage;
+            set_state(sim, GAME_STATE_WIN);
+        }
+
+        float speed = sx_lerp(1.0f, 4.0f, 1.0f - ((float)num_alive / (float)sim->num_enemies));
+        dte = sim->enemy_explosion ? 0.0f : (dt * speed);
+        sim->enemy_dt = dte;
+
+        update_formation(sim, dte);
+        if (formation_reached_player(sim)) {
+            set_state(sim, GAME_STATE_GAMEOVER);
+        }
+
+        // enemy shoot
+        if (sim->enemy_shoot_tm >= sim->enemy_shoot_interval && num_alive > 0) {
+            int alive_index = sx_rng_gen_rangei(&sim->rng, 0, num_alive - 1);
+            create_bullet(sim, sim->enemies.pos[alive_enemies[alive_index]], BULLET_TYPE_ALIEN1);
+            sim->enemy_shoot_tm = 0;
+            sim->enemy_shoot_interval =
+                ENEMY_SHOOT_INTERVAL + (sx_rng_genf(&sim->rng) * 2.0f - 1.0f) * 0.2f;
+        }
+        sim->enemy_shoot_tm += dte / speed;
+
+        // only the first enemy from the left crashes in a step, it's explosion stops the formation
+        // before the others get any closer. the crashed enemy leaves `alive_enemies`, so the
+        // local copies above are stale from here on
+        uint64_t stage_tm = begin_stage(sim);
+        if (find_cover_contacts(sim) > 0) {
+            resolve_cover_contact(sim, sim->hits[0]);
+            ++sim->collision_stats.hits[SIM_HIT_ENEMY_COVER];
+        }
+        stage_tm = end_stage(sim, SIM_COLLISION_STAGE_COVER_CONTACTS, stage_tm);
+
+        update_enemy_boxes(sim);
+        if (sim->config.broadphase == SIM_BROADPHASE_GRID) {
+            build_enemy_grid(sim);
+        }
+        end_stage(sim, SIM_COLLISION_STAGE_BUILD, stage_tm);
+    }
+
+    uint64_t stage_tm = begin_stage(sim);
+    update_world_hash(sim);
+    end_stage(sim, SIM_COLLISION_STAGE_BUILD, stage_tm);
+    update_bullets(sim, dt);
+
+    if (sim->enemy_explosion) {
+        if (sim->enemy_explosion_tm >= ENEMY_EXPLODE_TIME) {
+            sim->enemy_explosion = false;
+        }
+        sim->enemy_explosion_tm += dt;
+    }
+    update_explosions(sim, dt);
+
+    if (sim->player_died) {
+        if (sim->player_explosion.wait_tm >= PLAYER_EXPLOSION_DURATION) {
+            sim->player_died = false;
+            sim->player_explosion.wait_tm = 0;
+            if (sim->player_lives == 0) {
+                set_state(sim, GAME_STATE_GAMEOVER);
+            }
+        }
+        sim->player_explosion.wait_tm += dtp;
+    }
+
+    // saucer
+    saucer_t* saucer = &sim->saucer;
+    if (saucer->dead) {
+        if (saucer->wait_tm >= saucer->wait_duration) {
+            spawn_saucer(sim);
+            saucer->wait_tm = 0;
+        }
+        saucer->wait_tm += dt;
+    } else {
+        saucer->pos.x += saucer->speed * dt;
+        if (saucer->pos.x < (-GAME_BOARD_WIDTH * 0.5f - sim->tile_size) ||
+            saucer->pos.x > (GAME_BOARD_WIDTH * 0.5f + sim->tile_size)) {
+            saucer->dead = true;
+        }
+    }
+
+    // heartbeat sound
+    sim->heartbeat_tm += dte;
+    if (sim->heartbeat_tm >= HEARTBEAT_INTERVAL) {
+        play_sound(sim, SOUND_HEARTBEAT, 1);
+        sim->heartbeat_tm = 0;
+    }
+}
+
+static inline uint32_t hash_u32(uint32_t h, uint32_t v)
+{
+    // fnv1a
+    for (int i = 0; i < 4; i++) {
+        h = (h ^ ((v >> (i * 8)) & 0xff)) * 16777619u;
+    }
+    return h;
+}
+
+static inline uint32_t hash_f32(uint32_t h, float f)
+{
+    union {
+        float f;
+        uint32_t u;
+    } v = { .f = f };
+    return hash_u32(h, v.u);
+}
+
+uint32_t sim_checksum(const sim_state_t* sim)
+{
+    uint32_t h = 2166136261u;
+    h = hash_u32(h, (uint32_t)sim->state);
+    h = hash_u32(h, (uint32_t)sim->stage);
+    h = hash_u32(h, (uint32_t)sim->player_score);
+    h = hash_u32(h, (uint32_t)sim->high_score);
+    h = hash_u32(h, (uint32_t)sim->player_lives);
+    h = hash_f32(h, sim->player.pos.x);
+    h = hash_f32(h, sim->player.pos.y);
+    h = hash_f32(h, sim->formation.move_tm);
+    h = hash_u32(h, (uint32_t)sim->formation.xstep);
+    h = hash_u32(h, (uint32_t)sim->formation.dir);
+    for (int i = 0; i < sim->num_enemies; i++) {
+        h = hash_u32(h, sim_enemy_alive(sim, i) ? 0 : 1);
+        h = hash_f32(h, sim->enemies.pos[i].x);
+        h = hash_f32(h, sim->enemies.pos[i].y);
+    }
+    for (int i = 0; i < sim->config.num_covers; i++) {
+        const uint64_t* rows = cover_mask_rows(sim, i);
+        for (int y = 0; y < COVER_MASK_HEIGHT; y++) {
+            h = hash_u32(h, (uint32_t)rows[y]);
+            h = hash_u32(h, (uint32_t)(rows[y] >> 32));
+        }
+    }
+    h = hash_u32(h, (uint32_t)sim->num_bullets);
+    for (int i = 0; i < sim->num_bullets; i++) {
+        h = hash_f32(h, sim->bullets[i].pos.x);
+        h = hash_f32(h, sim->bullets[i].pos.y);
+    }
+    h = hash_u32(h, sim->saucer.dead);
+    h = hash_f32(h, sim->saucer.pos.x);
+    return h;
+}
+
+void sim_collision_stats_add(sim_collision_stats_t* dst, const sim_collision_stats_t* src)
+{
+    dst->num_candidates += src->num_candidates;
+    dst->num_candidates_dropped += src->num_candidates_dropped;
+    dst->num_tests += src->num_tests;
+    dst->num_enemy_queries += src->num_enemy_queries;
+    dst->num_enemy_queries_rejected += src->num_enemy_queries_rejected;
+    for (int i = 0; i < SIM_HIT_COUNT; i++) {
+        dst->hits[i] += src->hits[i];
+    }
+    dst->num_bullet_hits += src->num_bullet_hits;
+    for (int i = 0; i < SIM_COLLISION_STAGE_COUNT; i++) {
+        dst->stage_ticks[i] += src->stage_ticks[i];
+    }
+}
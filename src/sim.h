@@ -0,0 +1,366 @@
+#pragma once
+
+// Game simulation: all the gameplay logic of space-invaders without any dependency on rizz plugins
+// (no graphics, sound, input or coroutines). Side-effects like sounds and game state transitions are
+// emitted as events and consumed by the host (the game plugin or the headless runner)
+
+#include "sx/allocator.h"
+#include "sx/bitarray.h"
+#include "sx/jobs.h"
+#include "sx/math.h"
+#include "sx/rng.h"
+
+#include "aabb.h"
+#include "grid.h"
+#include "pool.h"
+#include "shash.h"
+
+#define DEFAULT_ENEMIES_PER_ROW 11
+#define DEFAULT_NUM_ROWS 5
+#define DEFAULT_MAX_BULLETS 20
+#define DEFAULT_MAX_EXPLOSIONS 20
+#define DEFAULT_NUM_COVERS 4
+#define GAME_BOARD_WIDTH 1.0f
+#define GAME_BOARD_HEIGHT 1.2f
+#define ENEMY_WAIT_DURATION 0.5f
+#define FORMATION_MOVE_DURATION (ENEMY_WAIT_DURATION + 2.0f)    // + 1 of stagger and 1 to move
+#define PLAYER_BULLET_INTERVAL 0.5f
+#define ENEMY_EXPLODE_TIME 0.2f
+#define ENEMY_SHOOT_INTERVAL 1.0f
+#define ENEMY_TILE_MOVE_DURATION 0.5f
+#define PLAYER_EXPLOSION_DURATION 1.0f
+#define HEARTBEAT_INTERVAL 1.5f
+#define NUM_LIVES 3
+#define GAME_STATE_DURATION 2.0f
+#define COVER_MASK_WIDTH 44    // size of cover.png, each bit of the mask is a pixel of the image
+#define COVER_MASK_HEIGHT 32
+#define SIM_MAX_EVENTS 64
+#define SIM_MIN_BULLETS_PER_JOB 64    // below this, bullet collisions are not worth a job dispatch
+#define SIM_MAX_HASH_CANDIDATES 16    // spatial hash items tested by a bullet, more are dropped
+
+typedef enum enemy_direction_t {
+    ENEMY_MOVEMENT_RIGHT = 0,
+    ENEMY_MOVEMENT_DOWN,
+    ENEMY_MOVEMENT_LEFT
+} enemy_direction_t;
+
+typedef enum enemy_kind_t {
+    ENEMY_KIND_3 = 0,
+    ENEMY_KIND_1,
+    ENEMY_KIND_2,
+    ENEMY_KIND_COUNT
+} enemy_kind_t;
+
+typedef enum bullet_type_t {
+    BULLET_TYPE_PLAYER = 0,
+    BULLET_TYPE_ALIEN1,
+    BULLET_TYPE_COUNT
+} bullet_type_t;
+
+typedef enum explosion_type_t {
+    EXPLOSION_TYPE_ENEMY = 0,
+    EXPLOSION_TYPE_BOUNDS,
+    EXPLOSION_TYPE_COUNT
+} explosion_type_t;
+
+typedef enum sound_type_t {
+    SOUND_EXPLODE1 = 0,
+    SOUND_EXPLODE2,
+    SOUND_EXPLODE3,
+    SOUND_EXPLODE4,
+    SOUND_HEARTBEAT,
+    SOUND_HIT,
+    SOUND_SHOOT,
+    SOUND_WIN,
+    SOUND_BONUS,
+    SOUND_SAUCER,
+    SOUND_COUNT
+} sound_type_t;
+
+typedef enum game_state_t {
+    GAME_STATE_INGAME = 0,
+    GAME_STATE_GAMEOVER,
+    GAME_STATE_WIN
+} game_state_t;
+
+typedef enum sim_event_type_t {
+    SIM_EVENT_SOUND = 0,    // play `sound` on `bus`
+    SIM_EVENT_STOP_SOUNDS,  // stop all playing sounds
+    SIM_EVENT_STATE,        // game state changed to `state`
+    SIM_EVENT_HIGH_SCORE    // high score changed, host may want to save it
+} sim_event_type_t;
+
+typedef struct sim_event_t {
+    sim_event_type_t type;
+    union {
+        struct {
+            sound_type_t sound;
+            int bus;
+        };
+        game_state_t state;
+    };
+} sim_event_t;
+
+// input state for a single step, filled by host from input devices or recorded data
+typedef struct sim_input_t {
+    bool left;
+    bool right;
+    bool shoot;
+    float movex;    // analog stick [-1, 1]
+} sim_input_t;
+
+// optional job dispatcher, signatures match the ones in rizz_api_core
+// if not set, the work is done on the calling thread
+typedef struct sim_jobs_t {
+    sx_job_t (*dispatch)(int count, void (*callback)(int start, int end, int thrd_index, void* user),
+                         void* user, sx_job_priority priority, uint32_t tags);
+    void (*wait_and_del)(sx_job_t job);
+} sim_jobs_t;
+
+// broadphase of player bullets against enemies, both find the same hits
+typedef enum sim_broadphase_t {
+    SIM_BROADPHASE_FORMATION = 0,    // direct row/column lookup in the lockstep enemy formation
+    SIM_BROADPHASE_GRID              // uniform grid of alive enemies, rebuilt every step
+} sim_broadphase_t;
+
+// formation dimensions and entity capacities, fixed for the lifetime of a simulation instance
+// bigger formations are scaled down (smaller tile size) to fit the board
+typedef struct sim_config_t {
+    int enemies_per_row;
+    int num_rows;
+    int max_bullets;       // when full, new bullets are dropped and counted by `bullet_pool`
+    int max_explosions;    // when full, new explosions are dropped and counted by `explosion_pool`
+    int num_covers;
+    sim_broadphase_t broadphase;
+} sim_config_t;
+
+// local collision bounds of each entity kind, relative to entity position
+typedef struct sim_bounds_t {
+    sx_rect enemies[ENEMY_KIND_COUNT];
+    sx_rect enemy_max;    // union of the bounds of all enemy kinds
+    sx_rect bullets[BULLET_TYPE_COUNT];
+    sx_rect player;
+    sx_rect cover;
+    sx_rect saucer;
+} sim_bounds_t;
+
+// enemies are stored as an array for each field, so a loop only touches the bytes it reads. alive
+// ones have a bit in `alive` and loops visit them with `sim_state_t.alive_enemies`
+// score and explosion sound only depend on the kind, movement is shared by the formation
+typedef struct sim_enemies_t {
+    sx_bitarray alive;
+    sx_vec2* pos;     // derived from the formation each step, frozen when the enemy dies
+    uint8_t* kind;    // enemy_kind_t
+} sim_enemies_t;
+
+// the formation moves a tile at a time and the enemies follow it one after the other: enemy N of
+// M starts it's part of the move `ENEMY_WAIT_DURATION + N/M` after the move started and takes 1
+// to finish it. positions only depend on this state and the place of each enemy in the layout
+typedef struct sim_formation_t {
+    sx_vec2 offset;    // sum of the finished moves
+    float move_tm;     // enemy time since the current move started
+    int xstep;         // tiles moved to the right since the last move down, negative to the left
+    enemy_direction_t dir;
+} sim_formation_t;
+
+typedef struct player_t {
+    sx_vec2 pos;
+    float bullet_tm;
+    float speed;
+    bool dead;
+} player_t;
+
+typedef struct cover_t {
+    sx_vec2 pos;
+    int health;    // percentage of the pixels left
+    bool dead;     // no pixels left
+} cover_t;
+
+typedef struct saucer_t {
+    bool dead;
+    sx_vec2 pos;
+    float t;
+    float speed;
+    float wait_tm;
+    float wait_duration;
+    int hit_score;
+} saucer_t;
+
+typedef struct bullet_t {
+    sx_vec2 pos;
+    bullet_type_t type;
+    float speed;
+    int damage;
+} bullet_t;
+
+typedef struct explosion_t {
+    sx_vec2 pos;
+    explosion_type_t type;
+    float wait_tm;
+} explosion_t;
+
+// collision layers, each bullet type collides with the layers in it's mask:
+// player bullets with enemies, saucer, covers and alien bullets, alien bullets with player, covers
+// and player bullets. enemies are found through the enemy broadphase, bullets through the
+// sort-and-sweep of all bullets, everything else through the spatial hash
+typedef enum sim_layer_t {
+    SIM_LAYER_ENEMY = 0x1,
+    SIM_LAYER_SAUCER = 0x2,
+    SIM_LAYER_PLAYER = 0x4,
+    SIM_LAYER_COVER = 0x8,
+    SIM_LAYER_PLAYER_BULLET = 0x10,
+    SIM_LAYER_ALIEN_BULLET = 0x20
+} sim_layer_t;
+
+typedef enum sim_hit_type_t {
+    SIM_HIT_NONE = 0,
+    SIM_HIT_ENEMY,          // bullet hit enemy `target`
+    SIM_HIT_SAUCER,
+    SIM_HIT_PLAYER,
+    SIM_HIT_COVER,          // bullet hit pixel (`pixel_x`, `pixel_y`) of cover `target`
+    SIM_HIT_BOUNDS,         // bullet left the board
+    SIM_HIT_ENEMY_COVER,    // enemy `source` crashed into cover `target`
+    SIM_HIT_COUNT
+} sim_hit_type_t;
+
+// hit found by collision detection, which only reads the world. the side effects (score,
+// explosions, sounds, removals) are applied later by a single resolve pass, in a stable order
+typedef struct sim_hit_t {
+    uint8_t type;    // sim_hit_type_t
+    uint8_t pixel_x;
+    uint8_t pixel_y;
+    int source;    // bullet index, or enemy index for SIM_HIT_ENEMY_COVER
+    int target;
+    pool_handle_t bullet;    // handle of the source bullet, still safe after it moves or is removed
+    float toi;             // time of impact in the step [0, 1]
+    int num_candidates;    // collision stats of the detection, see sim_collision_stats_t
+    int num_candidates_dropped;
+    int num_tests;
+    int num_bounds_lookups;    // see sim_state_t
+} sim_hit_t;
+
+typedef enum sim_collision_stage_t {
+    SIM_COLLISION_STAGE_COVER_CONTACTS = 0,    // bottom enemies of the columns against the covers
+    SIM_COLLISION_STAGE_BUILD,                 // enemy boxes, enemy grid and world hash
+    SIM_COLLISION_STAGE_DETECT,                // bullet hits, in parallel
+    SIM_COLLISION_STAGE_RESOLVE,
+    SIM_COLLISION_STAGE_BULLETS,               // bullets against bullets
+    SIM_COLLISION_STAGE_COUNT
+} sim_collision_stage_t;
+
+// counters of the collision work in a step. candidates are what the broadphases hand out (enemy
+// boxes in the queried grid cells or formation rows, world hash items, bullet pairs of the sweep,
+// covers under the column bottoms), tests are the exact tests done on them
+typedef struct sim_collision_stats_t {
+    uint64_t num_candidates;
+    uint64_t num_candidates_dropped;    // world hash items over SIM_MAX_HASH_CANDIDATES, not tested
+    uint64_t num_tests;
+    uint64_t num_enemy_queries;             // player bullets tested against the enemies
+    uint64_t num_enemy_queries_rejected;    // .. rejected early by `formation_box`
+    uint64_t hits[SIM_HIT_COUNT];           // resolved hits by type
+    uint64_t num_bullet_hits;               // bullet against bullet, pairs
+    uint64_t stage_ticks[SIM_COLLISION_STAGE_COUNT];    // only with `time_collisions`
+} sim_collision_stats_t;
+
+typedef struct sim_state_t {
+    sx_rng rng;
+    const sim_jobs_t* jobs;
+    int min_bullets_per_job;    // SIM_MIN_BULLETS_PER_JOB after sim_init, lower to test the jobs
+    bool time_collisions;       // measure the collision stages in `collision_stats`
+    sim_config_t config;
+    sim_bounds_t bounds;
+    int num_enemies;    // enemies_per_row * num_rows
+    sim_enemies_t enemies;
+    cover_t* covers;
+    bullet_t* bullets;
+    saucer_t saucer;
+    int num_bullets;
+    pool_t bullet_pool;    // handles of `bullets`, follows the swap-removes
+    sim_hit_t* hits;       // scratch array, hits of the last resolve pass in resolve order
+    int num_hits;
+    int* bullet_order;     // bullet indices sorted along x for sort-and-sweep, -1 for removed ones
+    int* bullet_rank;      // position of each bullet in `bullet_order`
+    int num_bullet_order;
+    int* bullet_pairs;         // scratch array, colliding bullet pairs found by the sweep
+    uint8_t* bullet_claimed;   // scratch array, bullet is in one of the pairs
+    explosion_t* explosions;
+    int num_explosions;
+    pool_t explosion_pool;
+    int* alive_enemies;       // indices of alive enemies in ascending order, see kill_enemy
+    int* column_bottom;       // bottom-most alive enemy of each formation column, or -1
+    int num_alive_enemies;
+    sx_vec2 formation_pos;    // position of the first enemy in the layout, before any moves
+    sim_formation_t formation;
+    sx_rect formation_box;    // union of the alive enemy boxes, empty when all are dead
+    grid_t enemy_grid;        // only with SIM_BROADPHASE_GRID
+    shash_t world_hash;       // saucer, player and covers, rebuilt before the bullets move
+
+    // world bounds of entities for the overlap kernel, dead or removed entities have empty boxes
+    aabb_soa_t enemy_boxes;     // updated each step, after enemies move
+    aabb_soa_t bullet_boxes;    // same order as `bullets`
+    aabb_soa_t cover_boxes;
+
+    // pixels of the covers, eroded by bullets and enemies. one 64-bit register for each row,
+    // COVER_MASK_HEIGHT rows per cover. bit 0 is the left column and row 0 is the top
+    sx_bitarray cover_masks;
+
+    player_t player;
+    float tile_size;
+    float cover_size;
+    bool enemy_explosion;
+    float enemy_explosion_tm;
+    sx_vec2 enemy_explosion_pos;
+    float enemy_shoot_tm;
+    float enemy_shoot_interval;
+    explosion_t player_explosion;
+    int player_lives;
+    bool player_died;
+    float heartbeat_tm;
+    int player_score;
+    game_state_t state;
+    float state_tm;
+    int stage;
+    int high_score;
+    float enemy_dt;    // scaled delta-time of enemies in the last step, used for animations
+
+    sim_event_t events[SIM_MAX_EVENTS];
+    int num_events;
+    int num_events_dropped;
+
+    // cached bounds and boxes read in the last step (player movement, bullet hits, enemies against
+    // covers and bullets against bullets), each one in place of a sprite.draw_bounds call through
+    // the 2d plugin that the game used to make there
+    uint64_t num_bounds_lookups;
+
+    sim_collision_stats_t collision_stats;    // of the last step
+} sim_state_t;
+
+sim_config_t sim_default_config(void);
+
+// config: optional, if NULL the default config (original game) is used
+// entity arrays are allocated from `alloc` in a single block, returns false if out of memory
+bool sim_init(sim_state_t* sim, const sx_alloc* alloc, const sim_config_t* config, uint32_t seed);
+void sim_release(sim_state_t* sim, const sx_alloc* alloc);
+
+// copies the whole state, both instances must be initialized with the same config
+void sim_copy(sim_state_t* dst, const sim_state_t* src);
+
+void sim_refresh(sim_state_t* sim);
+void sim_step(sim_state_t* sim, const sim_input_t* input, float dt);
+
+// fires a bullet at `pos` outside of the game rules, to set up collision cases
+// returns POOL_INVALID_HANDLE if the bullet pool is full
+pool_handle_t sim_add_bullet(sim_state_t* sim, sx_vec2 pos, bullet_type_t type);
+
+// row of the mask of an intact cover
+uint64_t sim_cover_mask_row(int row);
+
+// hash of the gameplay state, used to check that two runs of the simulation are identical
+uint32_t sim_checksum(const sim_state_t* sim);
+
+static inline bool sim_enemy_alive(const sim_state_t* sim, int index)
+{
+    return sx_bitarray_get(&sim->enemies.alive, index);
+}
+
+void sim_collision_stats_add(sim_collision_stats_t* dst, const sim_collision_stats_t* src);